@@ -1,60 +1,1108 @@
 //Program to manage and manipulate arcade game records using a linked list
 
+#include <algorithm>
+#include <atomic>
 #include <cctype> 
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream> 
-#include <iomanip> 
 #include <iostream> 
+#include <limits>
+#include <memory>
+#include <new>
+#include <queue>
 #include <sstream>
 #include <string> 
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
+//piece of text owned by a string arena (not null-terminated)
+struct TextRef
+{
+    const char* data = nullptr;  //first character of text (nullptr when no text is stored)
+    unsigned int size = 0;       //number of characters in text
+
+    //view of the text, for comparing and printing
+    string_view view() const { return string_view(data, size); }
+};
+
+//arena holding the text of every record (and the few RecordText structures): data is copied into large
+//blocks that never move, and is only freed when the whole arena goes away
+struct StringArena
+{
+    vector<unique_ptr<char[]>> blocks;  //blocks of memory text has been copied into
+    size_t used = 0;                    //number of characters used in last block
+    size_t capacity = 0;                //size of last block
+};
+
+//original text of fields whose stored number would not print back the same way (e.g. "0500" or "226.2500")
+//the program prints fields exactly as they were given, so these are kept for the rare records that need them
+struct RecordText
+{
+    TextRef highScore;  //text printed for high score
+    TextRef plays;      //text printed for plays
+    TextRef revenue;    //text printed for revenue (without the $)
+    TextRef initials;   //initials too long to fit inside GameData::initials
+};
+
 //structure to hold different pieces of data for the game record
 struct GameData
 {
-    string name;        //name of game
-    string highScore;   //highest score for game
-    string initials;    //initials of plater with highest score
-    string plays;       //number of times game has been played
-    string revenue;     //total revenue made from game
-    GameData* next;     //pointer to next GameData node in linked list
+    TextRef name;           //name of game (text lives in the list's string arena)
+    long long highScore;    //highest score for game
+    long long plays;        //number of times game has been played
+    long long revenue;      //total revenue made from game, in cents
+    char initials[8];       //initials of player with highest score (null-terminated)
+    RecordText* text;       //original text of fields that don't print the same as their number (nullptr for most records)
+#ifndef ARCADE_CONTIGUOUS_STORE
+    GameData* next;         //pointer to next GameData node in linked list
+    GameData* prev;         //pointer to previous GameData node, so a node can be unlinked without searching for it
+#endif
+    GameData* nextSameName; //next node with the same (case-insensitive) name, chained from the name index
+    unsigned long long order;  //position stamp: larger for nodes further down the list (renumbered after each sort;
+                               //with the contiguous store, the record's position in the store)
+    unsigned int searchId;  //number of node in the search index (only meaningful while the index is built)
+    unsigned int sequence;  //position of record in the whole list, while the records are split into shards (--shards)
+};
+
+//slot of the name index: chain of every node whose name matches (ignoring case), and the hash of that name
+struct NameSlot
+{
+    size_t hash = 0;            //hash of the (lowercase) name
+    GameData* chain = nullptr;  //first node of chain (nullptr when slot is unused)
+};
+
+//hash index from game name (ignoring case) to the chain of nodes with that name
+//uses open addressing (slots in one array, probing forward from the name's hash) so adding a name never allocates
+//the index is built the first time a name is looked up, so loading and batches that never look up a name don't pay for it
+struct NameIndex
+{
+    vector<NameSlot> slots;  //number of slots is always a power of two
+    size_t used = 0;         //number of slots holding a chain
+    bool built = false;      //whether the index has been built (and is being kept up to date)
+};
+
+//trigram index for substring search: every name is split into its overlapping runs of three lowercase characters,
+//and each trigram (hashed into one of a fixed number of buckets) lists the nodes whose name contains it
+//a search only has to check the nodes listed under the rarest trigram of its search term
+//deleted nodes are only blanked out of 'nodes' (the index is rebuilt once too many are), so deleting stays cheap
+//like the name index, it is built the first time a search needs it
+struct SearchIndex
+{
+    static const unsigned int bucketBits = 18;  //there are 2^bucketBits trigram buckets
+    vector<GameData*> nodes;               //node with each search id (nullptr once the node is deleted)
+    vector<vector<unsigned int>> buckets;  //search ids of nodes with a trigram in each bucket, in increasing order
+    size_t deleted = 0;                    //number of search ids whose node has been deleted
+    bool built = false;                    //whether the index has been built (and is being kept up to date)
+};
+
+//entry of an ordered index: a record's value of the indexed field, and its order stamp, which breaks ties
+//(so records with the same value stay in list order, as a stable sort leaves them)
+struct OrderedEntry
+{
+    long long value;           //value of indexed field
+    unsigned long long order;  //order stamp of record
+    GameData* node;            //record itself
+};
+
+//ordered index on one numeric field, for range commands and for sorting without comparing records:
+//entries are kept in order of value (then list order) in blocks of up to 2*blockSize entries, so adding or removing
+//an entry only moves the rest of its block (a B-tree two levels deep)
+//it is built the first time a range command needs it, or by a sort by its field, and is then kept up to date;
+//a sort by any other field changes which of two records with the same value comes first, so it drops the index
+struct OrderedIndex
+{
+    static const size_t blockSize = 512;  //blocks are split in two once they hold twice this many entries
+                                          //(each block has room for that many from the start, so adding never reallocates it)
+    vector<vector<OrderedEntry>> blocks;  //entries, in order (no block is empty)
+    bool built = false;                   //whether the index has been built (and is being kept up to date)
+};
+
+#ifdef ARCADE_CONTIGUOUS_STORE
+//record store of the contiguous backend (built with -DARCADE_CONTIGUOUS_STORE), used instead of linking nodes together:
+//records sit one after another in list order, in slabs of 'slabSize' records, so walking the list reads memory front
+//to back instead of following a pointer from each record to the next; a record's position in the store is its order stamp
+//deleting a record only marks its position as a tombstone; tombstones are squeezed out (moving the records after them
+//down) once they outnumber the records, and before each sort, which then moves the records themselves into order
+struct RecordStore
+{
+    static const size_t slabSize = 4096;   //number of records in a slab
+    vector<unique_ptr<GameData[]>> slabs;  //slab s holds positions s*slabSize to (s+1)*slabSize-1
+    vector<unsigned char> live;            //1 for each position holding a record, 0 for a tombstone
+    size_t used = 0;                       //number of positions handed out
+    size_t tombstones = 0;                 //number of positions whose record was deleted
+};
+#else
+//allocator for GameData nodes: nodes are handed out from large slabs, so nodes created together sit next to
+//each other in memory, and deleted nodes are kept on a free list for reuse
+struct NodePool
+{
+    vector<unique_ptr<GameData[]>> slabs;  //slabs of nodes handed out so far
+    size_t used = 0;                       //number of nodes handed out from last slab
+    size_t capacity = 0;                   //number of nodes in last slab
+    GameData* freeNodes = nullptr;         //deleted nodes waiting to be reused (linked through 'next')
+    bool useHeap = false;                  //allocate every node with its own new/delete instead (for comparison)
+};
+#endif
+
+struct SharedRecords;
+
+//copy of the numeric fields of every record, one column per field, in list order, for aggregate commands:
+//aggregates run over plain arrays (several values per instruction) instead of following 'next' from node to node
+//the columns are copied by the first aggregate that needs them and dropped by any change to the records,
+//so a run of aggregate commands shares one copy
+struct RecordColumns
+{
+    vector<long long> highScore;  //high score of each record
+    vector<long long> plays;      //plays of each record
+    vector<long long> revenue;    //revenue of each record, in cents
+    vector<GameData*> nodes;      //node each row was copied from
+    bool built = false;           //whether the columns match the records
+    bool check = false;           //also work out every aggregate one node at a time, and compare (--check-aggregates)
+    size_t mismatches = 0;        //number of aggregates that did not match when checked
+};
+
+//linked list of game records, plus the lookup structures kept up to date alongside it
+struct RecordList
+{
+#ifdef ARCADE_CONTIGUOUS_STORE
+    RecordStore store;              //owns the records, in list order
+#else
+    GameData* head = nullptr;       //first node in list (nullptr when list is empty)
+    GameData* tail = nullptr;       //last node in list, so records can be appended without walking the list
+    unsigned long long nextOrder = 0;  //order stamp given to the next appended node
+    NodePool pool;                  //owns the nodes themselves
+#endif
+    size_t size = 0;                //number of nodes in list
+
+    StringArena arena;              //owns the text of names, and the RecordText of records that need one
+
+    //index from game name (ignoring case) to a chain of every node with that name (usually just one)
+    NameIndex nameIndex;
+
+    //index from trigrams of names to the nodes containing them, for substring search
+    SearchIndex searchIndex;
+
+    //columns of the numeric fields, for aggregate commands
+    RecordColumns columns;
+
+    //indexes keeping the records in order of plays, high score and revenue (see orderedFields)
+    OrderedIndex orderedIndexes[3];
+
+    //buffers every search reuses, so searches stop allocating once they have grown big enough
+    string searchTerm;               //search term, in lowercase
+    vector<GameData*> searchMatches; //records the search found
+
+    //records the last reprice left alone because their new revenue would not fit (buffer reused by every reprice)
+    vector<GameData*> repriceOverflows;
+
+    //views of the records published to concurrent reader threads (nullptr unless records are being shared)
+    SharedRecords* shared = nullptr;
+
+    unsigned long long nodesVisited = 0;  //records looked at by commands so far (for --stats)
+};
+
+//text of a numeric field, ready to print: either the field's stored original text or its number formatted into 'digits'
+struct FieldText
+{
+    char digits[24];                //buffer number is formatted into
+    const char* stored = nullptr;   //stored original text (nullptr when number was formatted into 'digits')
+    size_t size = 0;                //number of characters of text
+
+    //view of the text, for comparing and printing
+    string_view view() const { return string_view(stored != nullptr ? stored : digits, size); }
+};
+
+//fields the records can be sorted by
+enum class SortKey
+{
+    Name,
+    Plays,
+    HighScore,
+    Revenue,
+    Initials
+};
+
+//fields with an ordered index, in the order of RecordList::orderedIndexes
+const SortKey orderedFields[]{ SortKey::Plays, SortKey::HighScore, SortKey::Revenue };
+
+//read-only view of the whole contents of a file, memory-mapped where the system supports it
+struct MappedFile
+{
+    const char* data = nullptr;  //first byte of file (nullptr for an empty file)
+    size_t size = 0;             //number of bytes in file
+    void* mapping = nullptr;     //start of memory mapping, if the file is mapped
+    vector<char> copy;           //file contents, on systems where the file is read instead of mapped
+
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+};
+
+//formats a database file can be in
+enum class DatabaseFormat
+{
+    Text,     //one "Name, HighScore, Initials, Plays, $Revenue" line per record
+    Snapshot  //binary snapshot (see SnapshotHeader)
+};
+
+//binary snapshot of a database: this header, then 'recordCount' SnapshotRecords, then 'textCount' SnapshotTexts,
+//then 'heapSize' bytes of string heap holding every piece of text the records refer to
+//numbers are stored in the byte order of the machine that wrote the snapshot ('byteOrder' tells which)
+struct SnapshotHeader
+{
+    char magic[8];          //"ARCADEDB"
+    uint32_t version;       //snapshot format version (snapshotVersion)
+    uint32_t byteOrder;     //0x01020304 as written by the machine that made the snapshot
+    uint32_t recordSize;    //sizeof(SnapshotRecord)
+    uint32_t textSize;      //sizeof(SnapshotText)
+    uint64_t recordCount;   //number of records
+    uint64_t textCount;     //number of SnapshotTexts
+    uint64_t heapSize;      //number of bytes in string heap
+    uint64_t checksum;      //snapshotChecksum of everything after the header
+    uint64_t reserved;      //always 0
+};
+
+//piece of text in a snapshot's string heap
+struct SnapshotString
+{
+    uint64_t offset;   //position of text in string heap (snapshotNoText when there is no text)
+    uint32_t size;     //number of characters in text
+    uint32_t reserved; //always 0
+};
+
+//one record of a snapshot (fixed width, so records can be read straight out of the file)
+struct SnapshotRecord
+{
+    SnapshotString name;  //name of game
+    int64_t highScore;    //highest score for game
+    int64_t plays;        //number of times game has been played
+    int64_t revenue;      //total revenue made from game, in cents
+    char initials[8];     //initials, when they fit (null-terminated)
+    uint64_t text;        //index of record's SnapshotText (snapshotNoText for records without one)
+};
+
+//original text of a snapshot record's fields (see RecordText)
+struct SnapshotText
+{
+    SnapshotString highScore;
+    SnapshotString plays;
+    SnapshotString revenue;
+    SnapshotString initials;
+};
+
+const uint32_t snapshotVersion{ 1 };
+const uint64_t snapshotNoText{ ~uint64_t{ 0 } };
+
+//snapshot being put together one record at a time (written out by writeSnapshot)
+struct SnapshotBuilder
+{
+    vector<SnapshotRecord> records;  //records added so far
+    vector<SnapshotText> texts;      //original text of the records that have any
+    string heap;                     //text of names and original field text
+};
+
+//how the batch file asked for records to be sorted
+struct SortMethod
+{
+    SortKey key = SortKey::Plays;  //field to sort by
+    bool descending = false;       //sort largest first instead of smallest first
+    bool known = false;            //false if the method was not recognised (records are then listed unsorted)
+};
+
+//function that says whether record 'a' belongs strictly before record 'b' in one sort method's order
+//(recordOrderFor picks it once per sort, so merges of sorted records don't look at the method on every comparison)
+using RecordOrder = bool (*)(const GameData& a, const GameData& b);
+
+//things an aggregate command can work out over a numeric field
+enum class AggregateFunction
+{
+    Sum,
+    Min,
+    Max,
+    Top,         //records with the largest values
+    Percentile,  //value below which the given percentage of records fall (nearest rank)
+    Histogram    //number of records in each of a number of equally wide ranges of values
+};
+
+//what an aggregate command asked for
+struct AggregateQuery
+{
+    AggregateFunction function = AggregateFunction::Sum;  //what to work out
+    SortKey field = SortKey::Plays;  //field to work it out over (plays, high score or revenue)
+    size_t count = 0;                //top: number of records; histogram: number of buckets
+    double percentile = 0;           //percentile: percentage (0 to 100)
+    string_view text;                //query as given in the batch file
+};
+
+//result of an aggregate command
+struct AggregateResult
+{
+    size_t count = 0;              //number of records aggregated over
+    long long value = 0;           //sum, min, max or percentile
+    bool overflowed = false;       //sum: the total is too large (or too small) for a long long, so 'value' isn't it
+    vector<GameData*> records;     //top: records, largest value first
+    long long low = 0;             //histogram: first value of first bucket
+    unsigned long long width = 0;  //histogram: number of values each bucket covers
+    vector<size_t> buckets;        //histogram: number of records in each bucket
+};
+
+//what a range command asked for: the records whose field is from 'low' to 'high', in order of that field
+struct RangeQuery
+{
+    SortKey field = SortKey::Plays;                        //field to list records by (plays, high score or revenue)
+    long long low = numeric_limits<long long>::min();      //smallest value to list (the lowest there is for *)
+    long long high = numeric_limits<long long>::max();     //largest value to list (the highest there is for *)
+    bool bounded = false;                                  //whether bounds were given (otherwise every record is listed)
+    bool descending = false;                               //list largest value first instead of smallest first
+};
+
+//kinds of batch command (the number each command line starts with)
+enum class CommandType : unsigned char
+{
+    Add = 1,
+    Search = 2,
+    Edit = 3,
+    Delete = 4,
+    Sort = 5,
+    Aggregate = 6,
+    Reprice = 7,
+    Range = 8
+};
+
+//one command of the batch file, already split into its fields
+//text fields view the batch file's contents, which stay loaded while the batch runs
+struct BatchCommand
+{
+    CommandType type{};       //which command this is
+    unsigned int lineNumber{ 0 };  //line of batch file the command came from
+    string_view name;         //add/edit: game name; search: search term; delete: name of record to delete;
+                              //reprice: game to reprice (empty for every game)
+    string_view value;        //add: high score; edit: new value for field
+    string_view initials;     //add: initials
+    string_view plays;        //add: plays
+    string_view revenue;      //add: revenue (without the $)
+    char field{ '\0' };       //edit: field number ('1', '2' or '3')
+    string_view line;         //whole line the command was parsed from (what the journal records)
+    SortMethod sortMethod;    //sort: what to sort by
+    AggregateQuery aggregate; //aggregate: what to work out
+    long long price{ 0 };     //reprice: price per play, in cents
+    RangeQuery range;         //range: records to list
+};
+
+//batch file parsed into commands, ready to run
+struct Batch
+{
+    MappedFile file;                //contents of batch file
+    vector<BatchCommand> commands;  //commands, in file order
+    size_t errorCount = 0;          //number of lines that were not valid commands
+};
+
+//how many times each command had each outcome (what quiet mode reports instead of the full output)
+struct ReportCounts
+{
+    size_t added = 0;             //records added
+    size_t searches = 0;          //searches run
+    size_t searchMatches = 0;     //records found by searches (a search can find several)
+    size_t searchesNotFound = 0;  //searches that found nothing
+    size_t edited = 0;            //records edited
+    size_t editsNotFound = 0;     //edits whose record was not found
+    size_t deleted = 0;           //records deleted
+    size_t deletesNotFound = 0;   //deletes whose record was not found
+    size_t sorts = 0;             //sorts run
+    size_t aggregates = 0;        //aggregate commands run
+    size_t reprices = 0;          //reprice commands run
+    size_t repricedRecords = 0;   //records whose revenue was changed by reprices
+    size_t repricesNotFound = 0;  //reprices whose game was not found
+    size_t ranges = 0;            //range commands run
+    size_t rangeRecords = 0;      //records listed by range commands
+};
+
+//destination of the reports the batch commands print
+//text is collected in one large buffer that is written out whenever it fills up, instead of one field at a time
+struct ReportSink
+{
+    ostream* stream = &cout;  //where reports go (the console, or 'file')
+    ofstream file;            //report file, when reports are sent to a file
+    string buffer;            //report text not written out yet
+    size_t flushSize = 1 << 20;  //write buffer out once it holds this many characters
+    bool quiet = false;       //don't print reports, only count them
+    bool hold = false;        //keep all text in buffer (the reports of queued searches have to be printed first)
+    ReportCounts counts;      //outcomes of the commands run so far
+};
+
+//counters and latency histogram of one kind of command, for --stats
+//latencies are counted in buckets four to each power of two nanoseconds, so a bucket is at most 25% wide
+struct CommandStats
+{
+    static const size_t bucketCount = 256;     //enough buckets for any 64-bit number of nanoseconds
+    size_t count = 0;                          //commands run
+    unsigned long long nodesVisited = 0;       //records the commands looked at
+    unsigned long long totalNanoseconds = 0;   //time the commands took altogether
+    unsigned long long maxNanoseconds = 0;     //time the slowest command took
+    size_t latencyBuckets[bucketCount] = {};   //number of commands whose time fell in each bucket
+};
+
+//what a run did and how long each part of it took, for --stats
+struct RunStats
+{
+#ifdef ARCADE_NO_STATS
+    static constexpr bool enabled = false;  //built without instrumentation: everything that checks this compiles away
+#else
+    bool enabled = false;                   //whether stats are being collected
+#endif
+    CommandStats commands[9];               //stats of each command type, indexed by command number (0 is unused)
+    size_t loadedRecords = 0;               //records in the database once it was loaded
+    unsigned long long loadNanoseconds = 0; //time loading the database (and replaying its journal) took
+    size_t writtenRecords = 0;              //records saved at the end of the run
+    unsigned long long writeNanoseconds = 0;  //time saving them took
+};
+
+//where the chunks of a streamed batch come from: the text database, or a file of snapshots written by an earlier step
+struct ChunkReader
+{
+    ifstream file;           //file being read
+    bool snapshots = false;  //file is a series of snapshots (of up to streamBlockRecords records each), not a text database
+    size_t chunkBytes = 0;   //number of bytes to read into each chunk (at least one line or one snapshot is read)
+    string text;             //text database: text read but not parsed yet (the start of a line the last chunk cut off)
+    MappedFile snapshot;     //snapshots: copy of the snapshot being loaded
+    bool damaged = false;    //snapshots: a snapshot could not be read back
+};
+
+//piece of a streamed batch's report, kept in the spill file until the whole report can be put together in batch order
+struct ReportPiece
+{
+    size_t command;   //index of command the text belongs to
+    uint64_t offset;  //position of text in spill file
+    uint64_t size;    //number of bytes of text
+};
+
+//what one command of a streamed batch has done in the chunks streamed through it so far
+struct StreamedCommand
+{
+    bool found = false;  //edit/delete: record was found (so later chunks leave theirs alone); reprice: game was found;
+                         //sort: there were records enough to sort (and list)
+    size_t count = 0;    //search: records found; edit/delete: records changed; reprice: records changed
+};
+
+//batch run over a database streamed through it a chunk at a time, instead of loaded whole (--stream)
+struct StreamedBatch
+{
+    const Batch* batch = nullptr;      //batch being run
+    vector<StreamedCommand> commands;  //what each command has done so far
+    ReportSink spill;                  //report text of the chunk being streamed (written to the spill file)
+    uint64_t spillSize = 0;            //number of bytes of spill file taken by pieces so far
+    vector<ReportPiece> pieces;        //report text of the commands, in the order it was written
+    string tempName;                   //start of the names of temporary files (spill file, sorted runs, ...)
+    vector<string> tempFiles;          //every temporary file made so far (removed at the end)
+};
+
+//sorted run of records being merged: the block of it that is in memory, and the next of its records to merge
+struct MergeRun
+{
+    ChunkReader reader;         //run file
+    RecordList block;           //records read from it and not merged yet
+    GameData* next = nullptr;   //next record to merge (nullptr once the run is used up)
+};
+
+const size_t streamBlockRecords{ 4096 };  //number of records in each snapshot of a temporary file
+const size_t maxMergeRuns{ 64 };          //number of sorted runs merged at once
+
+//piece of a shard's report text (--shards): what one command printed or, for a search, one record it found, with the
+//record's sequence number, so the records every shard found can be put back in list order
+struct ShardPiece
+{
+    size_t begin;           //first character of piece in shard's report buffer
+    size_t end;             //one past its last character
+    unsigned int sequence;  //sequence number of the record found (searches only)
+};
+
+//one shard of a sharded run: the records whose name hashes to it, in the same order as in the whole list, and the
+//commands of the current window that it runs
+struct Shard
+{
+    RecordList list;                 //records of the shard
+    ReportSink report;               //reports of the window's commands (held until they are put in batch order)
+    vector<size_t> commands;         //batch positions of the window's commands that run on this shard, in batch order
+    vector<unsigned int> sequences;  //sequence number each of 'commands' gives the record it adds (adds only)
+    vector<size_t> pieceEnds;        //number of pieces printed once each of 'commands' has run
+    vector<ShardPiece> pieces;       //pieces of report text, in the order they were printed
+    vector<size_t> repriced;         //records changed by each of the window's reprices of every game
+};
+
+const size_t shardWindow{ 4096 };   //number of commands the shards run before their reports are put in batch order
+const unsigned int maxShards{ 64 };  //most shards a run can have
+
+//number of blocks of memory taken from the heap so far, for --check-allocations (only counted, by the replaced
+//operator new, in builds with -DARCADE_COUNT_ALLOCATIONS)
+atomic<unsigned long long> heapAllocations{ 0 };
+
+#ifndef _WIN32
+//stream buffer that reads and writes a file descriptor (a client's socket), so socket clients are served by the
+//same code as stdin and stdout; writes are not buffered here, since reports come in large blocks already
+struct DescriptorBuffer : streambuf
+{
+    int descriptor;    //socket being read and written
+    char input[4096];  //bytes read but not taken yet
+
+    explicit DescriptorBuffer(int socket) : descriptor(socket) {}
+
+protected:
+    int underflow() override;
+    int overflow(int character) override;
+    streamsize xsputn(const char* data, streamsize size) override;
+};
+#endif
+
+//immutable copy of a record, as published to concurrent readers
+struct ReadRecord
+{
+    GameData data;    //copy of record's fields (data.text points at 'text' when the record has original text)
+    RecordText text;  //copy of record's original field text
+};
+
+//run of consecutive records of a published view (never changed once published)
+struct ReadChunk
+{
+    vector<const ReadRecord*> records;  //records, in list order
+};
+
+//published version of the whole list, as concurrent readers see it (never changed once published)
+struct ReadView
+{
+    unsigned long long version = 0;   //number of views published before this one
+    size_t size = 0;                  //number of records
+    long long playsTotal = 0;         //sum of every record's plays (lets readers check that the view is consistent)
+    vector<const ReadChunk*> chunks;  //chunks holding the records, in list order
+};
+
+//objects taken out of the published view, waiting until no reader can still be using them
+struct RetiredObjects
+{
+    uint64_t epoch = 0;                 //epoch in which they were taken out
+    const ReadView* view = nullptr;     //view that was replaced
+    vector<const ReadChunk*> chunks;    //chunks the new view no longer uses
+    vector<const ReadRecord*> records;  //records the new view no longer uses
+};
+
+//epoch a reader thread announced when it started reading (0 while it is not reading)
+//each slot has a cache line of its own, so readers never write to memory another reader uses
+struct alignas(64) ReaderSlot
+{
+    atomic<uint64_t> epoch{ 0 };
+};
+
+//change made to the list by the writer, waiting to be published to readers
+struct PendingChange
+{
+    enum Kind { Added, Edited, Removed } kind;
+    GameData* node;            //record that was added or edited
+    unsigned long long order;  //order stamp of record
+};
+
+//records shared with concurrent reader threads (read-copy-update): readers get the current view without taking any
+//lock; the writer builds each new view from the old one, copying only what changed, and publishes it with one atomic
+//store; whatever the new view no longer uses is freed only once no reader can still be using it (epoch-based reclamation)
+struct SharedRecords
+{
+    static const size_t chunkSize = 1024;        //largest number of records in a chunk
+    static const size_t maxReaders = 64;         //number of reader slots
+    atomic<const ReadView*> current{ nullptr };  //view readers get
+    atomic<uint64_t> epoch{ 1 };                 //advanced each time a view is published
+    ReaderSlot readers[maxReaders];              //epoch each reader thread is reading in
+    uint64_t pinnedEpoch = 0;                    //oldest epoch whose view a queued search still needs (0 if none)
+    vector<PendingChange> pending;               //writer's changes since the last publish
+    bool rebuild = false;                        //whether every record changed (the list was sorted)
+    vector<RetiredObjects> retired;              //objects waiting to be freed
+};
+
+//search command of a batch, answered by a reader thread from the view published at its point in the batch
+struct SearchJob
+{
+    string_view term;                //search term
+    const ReadView* view = nullptr;  //view to search
+    uint64_t epoch = 0;              //epoch of view (keeps the view from being freed until the search is answered)
+    ReportSink report;               //report of search
+    size_t nodesVisited = 0;         //records the search looked at
+    unsigned long long nanoseconds = 0;  //time answering the search took
+    atomic<bool> done{ false };      //whether search has been answered
+};
+
+//reader threads answering a batch's searches while the writer carries on with the rest of the batch
+struct SearchReaders
+{
+    vector<thread> threads;       //reader threads
+    unique_ptr<SearchJob[]> jobs; //one job for each search of the batch
+    vector<string> segments;      //writer's report text that comes before each job's report
+    atomic<size_t> ready{ 0 };    //number of jobs queued by the writer
+    atomic<size_t> next{ 0 };     //next job a reader thread takes
+    atomic<bool> finished{ false };  //set once the writer has queued its last job
+    size_t drained = 0;           //number of jobs whose report has been printed
+    size_t answered = 0;          //number of jobs at the front that are all answered
+};
+
+//first bytes of a journal file: identifies the database file (the "base") the journal's commands apply to
+struct JournalHeader
+{
+    char magic[8];          //"ARCADEJL"
+    uint32_t version;       //journal format version (journalVersion)
+    uint32_t reserved;      //always 0
+    uint64_t baseSize;      //size of database file
+    uint64_t baseModified;  //last modification time of database file
+    uint64_t baseFileId;    //file number (inode) of database file, which changes whenever the file is replaced
+};
+
+//append-only log of the commands that changed the database since it was last written in full
+//each entry is a 4-byte length, a 4-byte checksum, then the batch file line of the command
+//entries are collected in 'buffer' and written out (and forced to disk) when the batch commits
+struct Journal
+{
+    bool enabled = false;  //whether commands are being journaled
+    string filename;       //journal file ("<database>.journal")
+    ofstream file;         //journal file, open for appending
+    string buffer;         //entries not written to the file yet
+    uint64_t size = 0;     //size of journal, including the entries still in 'buffer'
+    uint64_t baseSize = 0; //size of database file the journal applies to (to decide when to compact)
+};
+
+//database kept loaded by the server (--serve) between the batches sent to it
+struct ServedDatabase
+{
+    string filename;                               //database file
+    DatabaseFormat format = DatabaseFormat::Text;  //format of database file (what compacting it writes)
+    RecordList list;                               //records, as changed by every batch so far
+    Journal journal;                               //journal of database file (with --journal)
+    RunStats stats;                                //counters and timings of every batch so far (for --stats)
+    ReportCounts counts;                           //outcomes of every batch so far (for --stats)
+    bool changed = false;                          //whether a batch has changed the records since they were last saved
+    bool saved = false;                            //whether the records have been saved at all
+    chrono::steady_clock::time_point savedAt;      //when the records were last saved (or loaded)
+};
+
+//record of the reference engine (--check-reference): the program as it was first written, which keeps every field
+//as the text it prints as, in a singly linked list
+struct ReferenceRecord
+{
+    string name;             //name of game
+    string highScore;        //highest score for game
+    string initials;         //initials of player with highest score
+    string plays;            //number of times game has been played
+    string revenue;          //total revenue made from game
+    ReferenceRecord* next;   //next record in list
+};
+
+//ways the engine can run a batch, each of which --check-reference checks against the reference engine
+enum class EnginePath
+{
+    Batch,    //one list, commands in turn
+    Readers,  //searches answered by reader threads
+    Shards,   //records split between shards, one thread each
+    Stream    //database streamed through the batch a chunk at a time
+};
+
+const char* const enginePathNames[]{ "batch", "readers", "shards", "stream" };
+
+//what one run of a workload printed and saved, and how long it took (for --check-reference)
+struct EngineRun
+{
+    string report;        //everything the batch printed
+    string saved;         //contents of freeplay.dat afterwards
+    double seconds = 0;   //time to read the batch, load the database, run the batch and write freeplay.dat
+    bool ran = false;     //whether the run got as far as writing freeplay.dat
+};
+
+const uint32_t journalVersion{ 1 };
+
+//settings given on the command line (the program still prompts for its file names)
+struct ProgramOptions
+{
+    bool heapNodes = false;  //allocate nodes one at a time with new/delete instead of from the node pool
+    unsigned int loadThreads = 1;  //number of threads the database file is parsed with (0 means one per core)
+    unsigned int readerThreads = 0;  //number of threads answering the batch's searches (0 means searches run in turn)
+    double stressSeconds = 0;      //run the concurrent reader stress test for this long per reader count (0 means don't)
+    bool atomicWrite = false;      //write freeplay.dat to a temporary file first, then rename it into place
+    bool strictBatch = false;      //refuse to run a batch file that has any invalid lines
+    bool quiet = false;            //print only a summary of what the batch did, instead of every report
+    string reportFile;             //file to write reports to instead of the console (empty for the console)
+    bool convert = false;          //just convert 'convertInput' to 'convertOutput' (in 'convertFormat'), instead of running a batch
+    DatabaseFormat convertFormat = DatabaseFormat::Text;  //format to convert to
+    string convertInput;           //database file to convert (text or snapshot)
+    string convertOutput;          //file to write converted database to
+    bool journal = false;          //keep the database file up to date through its journal, instead of writing freeplay.dat
+    bool compact = false;          //fold the journal into a new database file at the end of the run, however small it is
+    bool checkAggregates = false;  //check every aggregate against a scalar walk of the list
+    bool checkAllocations = false; //instead of running the batch, check that searches, edits and deletes allocate nothing
+    bool stats = false;            //collect counters and timings, and print them as JSON at the end of the run
+    size_t streamBytes = 0;        //stream the database through the batch this many bytes at a time, instead of loading it
+                                   //(0 means load it)
+    string statsFile;              //file to write the stats to (empty for the error output)
+    bool generate = false;         //just write a synthetic database and batch file, instead of running a batch
+    uint64_t generateRecords = 0;  //number of records in the generated database
+    uint64_t generateCommands = 0; //number of commands in the generated batch file
+    string generateDatabase;       //file to write the generated database to
+    string generateBatch;          //file to write the generated batch file to
+    unsigned int commandMix[5] = { 20, 40, 25, 14, 1 };  //relative weights of add, search, edit, delete and sort commands
+    uint64_t seed = 1;             //seed of the generated workload (the same seed gives the same files)
+    unsigned int referenceWorkloads = 0;  //check this many generated workloads against the reference engine, instead
+                                          //of running a batch (0 means don't)
+    bool benchmark = false;        //time loading, each kind of command and writing, instead of printing reports
+    unsigned int shards = 1;       //number of shards the records are split into, each run by its own thread
+                                   //(1 means the batch runs on one list; 0 means one shard per core)
+    bool serve = false;            //keep the database loaded and run the batches sent to it, instead of one batch
+    string serveSocket;            //Unix socket to take clients on (empty to read requests from stdin)
+    double saveSeconds = -1;       //with --serve, save after a batch once this many seconds have passed since the last
+                                   //save (negative means only when asked, and at the end)
 };
 
 //forward declarations for functions:
-string toLowercase(string original);
-string cutLeadingZeroes(string original);
-void createLinkedList(GameData*& head, fstream& datfile);
-void addRecord(GameData*& head, const string& commandLine);
-void searchRecord(GameData*& head, const string& searchTerm);
-void editRecord(GameData*& head, const string& commandLine);
-void deleteRecord(GameData*& head, const string& recordToDelete);
-void sortRecords(GameData*& head, const string& sortMethod);
-void printList(ofstream& outFile, GameData* head);
-void writeRecordsToFile(GameData* head, const string& filename);
-
-int main()
+bool parseOptions(int argc, char* argv[], ProgramOptions& options);
+bool parseCommandMix(const string& text, unsigned int mix[5]);
+template <typename Number>
+bool parseOptionNumber(string_view text, Number& number);
+void toLowercase(string_view original, string& lowercase);
+double parseDouble(string_view text);
+string_view cutLeadingZeroes(string_view original);
+bool mapFile(const string& filename, MappedFile& file);
+void* allocateFromArena(StringArena& arena, size_t size, size_t alignment);
+TextRef storeText(StringArena& arena, string_view text);
+long long parseInteger(string_view text);
+long long parseCents(string_view text);
+bool integerPrintsAs(long long value, string_view text);
+bool centsPrintsAs(long long cents, string_view text);
+bool exactCents(string_view text, long long& cents);
+void setHighScore(RecordList& list, GameData& node, string_view text);
+void setPlays(RecordList& list, GameData& node, string_view text);
+void setRevenue(RecordList& list, GameData& node, string_view text);
+void setRevenue(RecordList& list, GameData& node, double value);
+void setInitials(RecordList& list, GameData& node, string_view text);
+FieldText highScoreText(const GameData& node);
+FieldText playsText(const GameData& node);
+FieldText revenueText(const GameData& node);
+string_view initialsText(const GameData& node);
+ostream& operator<<(ostream& out, const FieldText& field);
+#ifdef ARCADE_CONTIGUOUS_STORE
+GameData& recordAt(const RecordStore& store, size_t position);
+GameData* recordFrom(const RecordStore& store, size_t position);
+void forgetRecordPositions(RecordList& list);
+void compactRecords(RecordList& list);
+void permuteRecords(RecordList& list, const vector<size_t>& source);
+#else
+GameData* allocateNode(NodePool& pool);
+void freeNode(NodePool& pool, GameData* node);
+#endif
+GameData* allocateRecord(RecordList& list);
+void freeRecord(RecordList& list, GameData* node);
+GameData* firstRecord(const RecordList& list);
+GameData* nextRecord(const RecordList& list, const GameData* node);
+GameData* lastRecord(const RecordList& list);
+void freeAllRecords(RecordList& list);
+GameData* newRecord(RecordList& list, string_view name);
+GameData* copyRecord(RecordList& list, const GameData& node);
+size_t hashNameIgnoreCase(string_view name);
+bool equalsIgnoreCase(string_view a, string_view b);
+void reserveNames(NameIndex& index, size_t count);
+size_t findNameSlot(const NameIndex& index, string_view name, size_t hash);
+GameData*& addNameChain(NameIndex& index, string_view name, size_t hash);
+void removeNameSlot(NameIndex& index, size_t hole);
+void buildNameIndex(RecordList& list);
+void appendNode(RecordList& list, GameData* node);
+void unlinkNode(RecordList& list, GameData* node);
+GameData* findFirstByName(RecordList& list, string_view name);
+GameData* findFirstByNameIgnoreCase(RecordList& list, string_view name);
+unsigned int trigramBucket(char first, char second, char third);
+void addSearchNode(SearchIndex& index, GameData* node);
+void clearSearchIndex(SearchIndex& index, bool release);
+void buildSearchIndex(RecordList& list);
+bool containsIgnoreCase(string_view name, string_view lowercaseTerm);
+void findNamesContaining(RecordList& list, string_view lowercaseTerm, vector<GameData*>& matches);
+OrderedIndex* orderedIndexFor(RecordList& list, SortKey field);
+bool entryBefore(const OrderedEntry& a, const OrderedEntry& b);
+size_t findOrderedBlock(const OrderedIndex& index, const OrderedEntry& key);
+void addOrderedEntry(OrderedIndex& index, long long value, GameData* node);
+void removeOrderedEntry(OrderedIndex& index, long long value, const GameData* node);
+void addToOrderedIndexes(RecordList& list, GameData* node);
+void removeFromOrderedIndexes(RecordList& list, const GameData* node);
+void clearOrderedIndexes(RecordList& list);
+void fillOrderedIndex(OrderedIndex& index, const vector<OrderedEntry>& entries);
+void buildOrderedIndex(RecordList& list, SortKey field);
+void indexSortedList(RecordList& list, SortKey field, bool descending);
+void collectOrdered(OrderedIndex& index, long long low, long long high, bool descending, vector<OrderedEntry*>& entries);
+bool sortByOrderedIndex(RecordList& list, SortKey field, bool descending);
+GameData* parseDatabaseLine(RecordList& list, const char* begin, const char* end);
+void loadRecords(RecordList& list, const char* begin, const char* end);
+void appendList(RecordList& list, RecordList& other);
+void loadRecordsInParallel(RecordList& list, const char* begin, const char* end, unsigned int threads);
+bool createLinkedList(RecordList& list, const string& filename, unsigned int threads, DatabaseFormat& format);
+uint64_t snapshotChecksum(const char* data, size_t size);
+bool isSnapshot(const MappedFile& file);
+TextRef snapshotText(const SnapshotString& string, const char* heap, uint64_t heapSize, bool& valid);
+bool loadSnapshot(RecordList& list, const MappedFile& file);
+bool openReportFile(ReportSink& report, const string& filename);
+void flushReport(ReportSink& report);
+ReportSink& operator<<(ReportSink& report, string_view text);
+ReportSink& operator<<(ReportSink& report, char character);
+ReportSink& operator<<(ReportSink& report, const FieldText& field);
+void printReportSummary(ReportSink& report);
+bool parseCommand(string_view line, BatchCommand& command, string& error);
+bool loadBatch(const string& filename, Batch& batch);
+void parseBatch(Batch& batch, ostream& errors);
+void runBatch(RecordList& list, ReportSink& report, Journal& journal, const Batch& batch, unsigned int readerThreads, RunStats& stats);
+void countVisited(RecordList& list, size_t nodes);
+unsigned long long nanosecondsSince(chrono::steady_clock::time_point start);
+size_t latencyBucket(unsigned long long nanoseconds);
+unsigned long long bucketLimit(size_t bucket);
+void recordCommand(RunStats& stats, CommandType type, unsigned long long nanoseconds, size_t nodes);
+unsigned long long latencyAtFraction(const CommandStats& command, double fraction);
+void writeStats(ostream& out, const RunStats& stats, const ReportCounts& counts);
+void reportStats(const ProgramOptions& options, const RunStats& stats, const ReportCounts& counts);
+void addCounts(ReportCounts& total, const ReportCounts& counts);
+uint32_t journalChecksum(string_view data);
+JournalHeader journalHeaderFor(const string& database);
+bool sameBase(const JournalHeader& a, const JournalHeader& b);
+bool writeJournalFile(const string& filename, const JournalHeader& header, string_view entries);
+bool openJournal(Journal& journal, RecordList& list, const string& database);
+void journalCommand(Journal& journal, string_view line);
+bool commitJournal(Journal& journal);
+bool compactDatabase(RecordList& list, Journal& journal, const string& database, DatabaseFormat format);
+const ReadRecord* copyForReaders(const GameData& node);
+bool findInView(const ReadView& view, unsigned long long order, size_t& chunkIndex, size_t& position);
+void reclaimRetired(SharedRecords& shared);
+void publishView(SharedRecords& shared, const ReadView* view, RetiredObjects replaced);
+void publishAll(SharedRecords& shared, const RecordList& list);
+void publishChanges(SharedRecords& shared, const RecordList& list);
+void freeSharedRecords(SharedRecords& shared);
+const ReadView* beginRead(SharedRecords& shared, size_t slot);
+void endRead(SharedRecords& shared, size_t slot);
+size_t searchView(ReportSink& report, const ReadView& view, string_view searchTerm);
+void answerSearches(SearchReaders& readers);
+void drainSearches(SearchReaders& readers, SharedRecords& shared, ReportSink& report, bool wait);
+void queueSearch(SearchReaders& readers, SharedRecords& shared, ReportSink& report, string_view searchTerm);
+bool checkView(const ReadView& view);
+bool stressReaders(RecordList& list, const Batch& batch, double seconds);
+#ifdef ARCADE_COUNT_ALLOCATIONS
+void* countedAllocation(size_t size) noexcept;
+#endif
+bool checkAllocations(RecordList& list, const Batch& batch, ostream& out);
+uint64_t nextRandom(uint64_t& state);
+uint64_t randomBelow(uint64_t& state, uint64_t limit);
+uint64_t randomStateFor(uint64_t seed, uint64_t stream, uint64_t index);
+string syntheticName(uint64_t seed, uint64_t index);
+void appendSyntheticInitials(string& text, uint64_t& state);
+void appendSyntheticNumber(string& text, uint64_t& state, long long value);
+void appendSyntheticRecord(string& text, uint64_t seed, uint64_t index);
+string syntheticOtherCase(const string& name);
+void appendSyntheticCommand(string& text, uint64_t seed, uint64_t index, uint64_t& records, const unsigned int mix[5]);
+bool generateWorkload(uint64_t records, uint64_t commands, const string& database, const string& batch, const unsigned int mix[5], uint64_t seed);
+long long peakResidentKB();
+double timeAtFraction(const vector<double>& sortedSeconds, double fraction);
+bool runBenchmark(const string& database, const Batch& batch, const ProgramOptions& options);
+string referenceLowercase(string original);
+string referenceCutLeadingZeroes(string original);
+string referenceRevenue(double value);
+void referenceLoad(ReferenceRecord*& head, const string& database);
+void referenceAdd(ReferenceRecord*& head, ostream& out, const string& commandLine);
+void referenceSearch(ReferenceRecord* head, ostream& out, const string& searchTerm);
+void referenceEdit(ReferenceRecord* head, ostream& out, const string& commandLine);
+void referenceDelete(ReferenceRecord*& head, ostream& out, const string& recordToDelete);
+void referenceSort(ReferenceRecord*& head, ostream& out, const string& sortMethod);
+void referenceSave(ReferenceRecord* head, const string& filename);
+void runReference(const string& database, const string& batchFile, EngineRun& run);
+bool runEnginePath(EnginePath path, const string& database, const string& batchFile, EngineRun& run);
+bool readWholeFile(const string& filename, string& contents);
+size_t firstDifferentLine(const string& a, const string& b);
+bool checkWorkload(const string& workload, uint64_t records, uint64_t commands, const string& database, const string& referenceDatabase,
+    const string& batchFile, bool timed, const char* expectedReport);
+bool checkAgainstReference(const ProgramOptions& options);
+bool openChunkReader(ChunkReader& reader, const string& filename, bool snapshots, size_t chunkBytes);
+bool readChunk(ChunkReader& reader, RecordList& chunk);
+string streamTempFile(StreamedBatch& stream);
+bool writeSnapshotBlocks(ofstream& file, const RecordList& chunk);
+void keepReportPiece(StreamedBatch& stream, size_t command);
+void streamChunk(StreamedBatch& stream, RecordList& chunk, size_t first, size_t last, bool tail);
+bool mergeRuns(StreamedBatch& stream, const vector<string>& runs, const string& output, const SortMethod& sortMethod, size_t listFor);
+bool mergeSortedRuns(StreamedBatch& stream, vector<string> runs, const string& output, size_t sortCommand);
+void finishStreamedReport(StreamedBatch& stream, ReportSink& report);
+bool streamBatch(const string& database, const Batch& batch, ReportSink& report, const ProgramOptions& options);
+size_t shardFor(string_view name, size_t shards);
+bool runsOnEveryShard(const BatchCommand& command);
+bool canShardBatch(const Batch& batch, const ProgramOptions& options);
+void splitIntoShards(RecordList& list, vector<Shard>& shards);
+void gatherShards(RecordList& list, vector<Shard>& shards);
+void runShardCommands(Shard& shard, const Batch& batch);
+void collectShardReports(vector<Shard>& shards, ReportSink& report, const Batch& batch, size_t first, size_t last);
+void sortShards(vector<Shard>& shards, ReportSink& report, const SortMethod& sortMethod);
+void runShardedBatch(RecordList& list, ReportSink& report, Journal& journal, const Batch& batch, unsigned int shardCount);
+bool saveServedDatabase(ServedDatabase& served, const ProgramOptions& options);
+bool serveBatch(ServedDatabase& served, const ProgramOptions& options, Batch& batch, ostream& out);
+bool serveRequests(ServedDatabase& served, const ProgramOptions& options, istream& in, ostream& out, bool& stop);
+#ifndef _WIN32
+int listenOnSocket(const string& path);
+#endif
+bool runServer(const string& database, const ProgramOptions& options);
+void addRecord(RecordList& list, ReportSink& report, string_view name, string_view highScore, string_view initials, string_view plays, string_view revenue);
+void reportFoundRecord(ReportSink& report, const GameData& node);
+void searchRecord(RecordList& list, ReportSink& report, string_view searchTerm);
+void editRecord(RecordList& list, ReportSink& report, string_view batchfileName, char fieldNumber, string_view newValue);
+void deleteRecord(RecordList& list, ReportSink& report, string_view recordToDelete);
+bool revenueAtPrice(long long plays, long long price, long long& revenue);
+size_t repriceColumn(const long long* plays, long long* revenue, size_t count, long long price, size_t& overflowed);
+size_t repriceMatching(RecordList& list, string_view gameName, long long price, bool& found);
+void repriceRecords(RecordList& list, ReportSink& report, string_view gameName, long long price);
+void reportRepriceOverflow(ReportSink& report, const GameData& node, long long price);
+void reportReprice(ReportSink& report, string_view gameName, long long price, size_t changed);
+bool parseSortMethod(string_view text, SortMethod& method);
+const char* sortKeyName(SortKey key);
+void sortRecords(RecordList& list, ReportSink& report, const SortMethod& sortMethod);
+void reportSortHeading(ReportSink& report, const SortMethod& sortMethod);
+bool neverBefore(const GameData& a, const GameData& b);
+RecordOrder recordOrderFor(const SortMethod& sortMethod);
+bool parseAggregateQuery(string_view text, AggregateQuery& query);
+void buildColumns(RecordList& list);
+const vector<long long>& columnFor(const RecordColumns& columns, SortKey field);
+long long fieldValue(const GameData& node, SortKey field);
+void addCountingWraps(long long& total, long long& wraps, long long value);
+long long sumColumn(const long long* values, size_t count, bool& overflowed);
+void columnRange(const long long* values, size_t count, long long& low, long long& high);
+void countBuckets(const long long* values, size_t count, long long low, unsigned long long width, vector<size_t>& buckets);
+unsigned long long bucketWidth(long long low, long long high, size_t bucketCount);
+size_t percentileRank(double percentile, size_t count);
+AggregateResult aggregateColumns(RecordList& list, const AggregateQuery& query);
+AggregateResult aggregateList(const RecordList& list, const AggregateQuery& query);
+bool sameAggregate(const AggregateResult& a, const AggregateResult& b);
+FieldText aggregateValueText(SortKey field, long long value);
+void aggregateRecords(RecordList& list, ReportSink& report, const AggregateQuery& query);
+bool parseRangeBound(string_view word, SortKey field, long long& value);
+bool parseRangeQuery(string_view text, RangeQuery& query);
+void listRange(RecordList& list, ReportSink& report, const RangeQuery& query);
+bool changesRecords(CommandType type);
+void appendRecordLine(string& buffer, const GameData& node);
+bool printList(ofstream& outFile, const RecordList& list);
+bool syncFile(const string& filename);
+void addSnapshotRecord(SnapshotBuilder& snapshot, const GameData& node);
+bool writeSnapshot(ofstream& outputFile, SnapshotBuilder& snapshot);
+bool printSnapshot(ofstream& outputFile, const RecordList& list);
+bool writeRecordsToFile(const RecordList& list, const string& filename, bool atomic, DatabaseFormat format);
+
+int main(int argc, char* argv[])
 {
+    //read any options given on the command line
+    ProgramOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        return 1;
+    }
+
+    //console output is only flushed when we ask for it (or the report buffer fills), not before every read of cin
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+
+    //conversion between database formats runs on its own, without prompting for files or running a batch
+    if (options.convert)
+    {
+        RecordList list;
+#ifndef ARCADE_CONTIGUOUS_STORE
+        list.pool.useHeap = options.heapNodes;
+#endif
+        DatabaseFormat inputFormat{ DatabaseFormat::Text };
+        if (!createLinkedList(list, options.convertInput, options.loadThreads, inputFormat))
+        {
+            cerr << "datafile could not be read.\n";
+            return 1;
+        }
+
+        //with --journal, the input's journal is applied first, so the conversion has every committed change
+        Journal journal;
+        if (options.journal && !openJournal(journal, list, options.convertInput))
+        {
+            return 1;
+        }
+        bool converted = writeRecordsToFile(list, options.convertOutput, options.atomicWrite, options.convertFormat);
+        freeAllRecords(list);
+        return converted ? 0 : 1;
+    }
+
+    //so does writing a synthetic workload
+    if (options.generate)
+    {
+        return generateWorkload(options.generateRecords, options.generateCommands, options.generateDatabase,
+            options.generateBatch, options.commandMix, options.seed) ? 0 : 1;
+    }
+
+    //and so does checking the engine against the reference engine (on workloads it generates itself)
+    if (options.referenceWorkloads > 0)
+    {
+        return checkAgainstReference(options) ? 0 : 1;
+    }
+
     string database;  //variable for database filename
     string batch; //variable for batch filename
 
     //prompt user to enter name of database file, and store it in database variable
-    cout << "Enter Database Name: ";
+    cout << "Enter Database Name: " << flush;
     cin >> database;
 
+    //the server keeps the database loaded and runs the batches sent to it, instead of asking for one batch file
+    if (options.serve)
+    {
+        cout << '\n';
+        return runServer(database, options) ? 0 : 1;
+    }
+
     //prompt the user to enter name of batch file, and store it in batch variable
-    cout << "\nEnter batch file name: ";
+    cout << "\nEnter batch file name: " << flush;
     cin >> batch;
     cout << '\n';
 
-    //create an input filestream object for the batch file (reading)
-    ifstream batchfile(batch, ios::in);
+    //read whole batch file and parse every line into a command before anything runs
+    //(invalid lines are reported with their line numbers, and skipped)
+    Batch batchCommands;
 
     //check if batch file can be opened; if it cannot, print an error to the console and exit
-    if (!batchfile)
+    if (!loadBatch(batch, batchCommands))
     {
         cerr << "batchfile could not be opened for reading.\n";
         return 1;
     }
+    if (options.strictBatch && batchCommands.errorCount > 0)
+    {
+        cerr << "batchfile has " << batchCommands.errorCount << " invalid line(s); nothing was run.\n";
+        return 1;
+    }
+    if (options.shards != 1 && !canShardBatch(batchCommands, options))
+    {
+        return 1;
+    }
+
+    //the benchmark loads the database, runs the batch and writes freeplay.dat with its own timing around each step
+    if (options.benchmark && options.streamBytes == 0)
+    {
+        return runBenchmark(database, batchCommands, options) ? 0 : 1;
+    }
 
     //create the database file for reading, writing, and appending in binary mode
     //'ios::app' ensures that if file does not exist, it is created
@@ -80,565 +1128,7428 @@ int main()
         return 1;
     }
 
-    //initialize head(first node) of linked list to nullptr, meaning list is currently empty
-    GameData* head = nullptr;
+    //streaming runs the batch over the database a chunk at a time, so the database is never all in memory
+    if (options.streamBytes > 0)
+    {
+        ReportSink report;
+        report.quiet = options.quiet;
+        if (!options.reportFile.empty() && !openReportFile(report, options.reportFile))
+        {
+            cerr << "report file could not be opened for writing.\n";
+            return 1;
+        }
+        bool streamed = streamBatch(database, batchCommands, report, options);
+        if (report.quiet)
+        {
+            printReportSummary(report);
+        }
+        flushReport(report);
+        return streamed ? 0 : 1;
+    }
+
+    //create empty linked list (head is nullptr, meaning list is currently empty)
+    RecordList list;
+#ifndef ARCADE_CONTIGUOUS_STORE
+    list.pool.useHeap = options.heapNodes;
+#endif
+    list.columns.check = options.checkAggregates;
+
+    //counters and timings of the run, printed at the end with --stats
+    RunStats stats;
+#ifndef ARCADE_NO_STATS
+    stats.enabled = options.stats;
+#endif
+    chrono::steady_clock::time_point loadStart{ chrono::steady_clock::now() };
 
     //call function to fill linked list with records from database file
-    createLinkedList(head, datfile);
+    DatabaseFormat databaseFormat{ DatabaseFormat::Text };
+    if (!createLinkedList(list, database, options.loadThreads, databaseFormat))
+    {
+        cerr << "datafile could not be read.\n";
+        return 1;
+    }
 
-    //create a string object to store our batch file command lines in
-    string commandLine{};
+    //the stress test runs the batch's commands against concurrent readers, then stops (nothing is saved)
+    if (options.stressSeconds > 0)
+    {
+        bool passed = stressReaders(list, batchCommands, options.stressSeconds);
+        freeAllRecords(list);
+        return passed ? 0 : 1;
+    }
 
-    //keep reading in lines from our batch file until we get to end of file
-    while (!batchfile.eof())
+    //the allocation check runs the batch twice, counting what the second run allocates, then stops (nothing is saved)
+    if (options.checkAllocations)
     {
-        //while there are still lines to process, store each batchfile line in our commandLine string object
-        while (getline(batchfile, commandLine))
-        {
-            //if first character is the number '1', call function to add record to linked list
-            if (commandLine[0] == '1')
-            {
-                addRecord(head, commandLine);   //call add record function
-            }
-            //if first character is the number '2', parse our command line for search term, and call function to search for record in linked list
-            if (commandLine[0] == '2')
-            {
-                string searchTerm{ commandLine.substr(2) };   //get portion of command line starting from position 2 (after space)   
-                searchRecord(head, searchTerm);               //call search record function
-            }
-            //if first character is the number '3', call function to edit our record in linked list
-            if (commandLine[0] == '3')
-            {
-                editRecord(head, commandLine);  //call edit record function
-            }
-            //if first character is the number '4', parse command line for record to delete, and call function to delete record from linked list
-            if (commandLine[0] == '4')
-            {
-                string recordToDelete{ commandLine.substr(2) }; //get portion of command line starting from position 2 (after space)
-                deleteRecord(head, recordToDelete);             //call delete record function
-            }
-            //if first character is the number '5', parse command line for sort method, and call function to sort records in linked list
-            if (commandLine[0] == '5')
-            {
-                string sortMethod{ commandLine.substr(2) };  //get portion of command line starting from position 2 (after space)
-                sortRecords(head, sortMethod); //call sort records function
-            }
-        }
+        bool passed = checkAllocations(list, batchCommands, cout);
+        freeAllRecords(list);
+        return passed ? 0 : 1;
     }
 
-    //after processing all commands, write modified records to 'freeplay.dat' file
-    writeRecordsToFile(head, "freeplay.dat");
+    //with a journal, apply the changes made since the database file was last written, and journal this batch's changes
+    Journal journal;
+    if (options.journal && !openJournal(journal, list, database))
+    {
+        return 1;
+    }
+    if (stats.enabled)
+    {
+        stats.loadedRecords = list.size;
+        stats.loadNanoseconds = nanosecondsSince(loadStart);
+    }
+
+    //send reports to the console, or to the report file if one was given
+    ReportSink report;
+    report.quiet = options.quiet;
+    if (!options.reportFile.empty() && !openReportFile(report, options.reportFile))
+    {
+        cerr << "report file could not be opened for writing.\n";
+        return 1;
+    }
+
+    //run every command of the batch file, in order (or split between shards, with the same result)
+    if (options.shards != 1)
+    {
+        runShardedBatch(list, report, journal, batchCommands, options.shards);
+    }
+    else
+    {
+        runBatch(list, report, journal, batchCommands, options.readerThreads, stats);
+    }
+
+    //in quiet mode, print what the batch did instead; then write out whatever reports are still buffered
+    if (report.quiet)
+    {
+        printReportSummary(report);
+    }
+    flushReport(report);
+    chrono::steady_clock::time_point writeStart{ chrono::steady_clock::now() };
+
+    //with a journal, the batch's changes are now made permanent by forcing the journal to disk, and only once
+    //the journal has grown to half the size of the database file is the whole database rewritten (compacted)
+    if (journal.enabled)
+    {
+        if (!commitJournal(journal))
+        {
+            cerr << "journal could not be written.\n";
+            return 1;
+        }
+        if ((options.compact || journal.size > journal.baseSize / 2) && !compactDatabase(list, journal, database, databaseFormat))
+        {
+            cerr << "database could not be compacted (its journal still holds every change).\n";
+            return 1;
+        }
+    }
+    //otherwise, after processing all commands, write modified records to 'freeplay.dat' file
+    else
+    {
+        writeRecordsToFile(list, "freeplay.dat", options.atomicWrite, DatabaseFormat::Text);
+    }
+
+    //print the run's stats as JSON
+    if (stats.enabled)
+    {
+        stats.writtenRecords = list.size;
+        stats.writeNanoseconds = nanosecondsSince(writeStart);
+        reportStats(options, stats, report.counts);
+    }
+
+    //close database file after all operations are completed
+    datfile.close();
+
+    //free every record (and the text they use) in one go
+    freeAllRecords(list);
+
+    //return 0 to indicate successful execution of program (or 1 if an aggregate did not match its check)
+    return list.columns.mismatches > 0 ? 1 : 0;
+}
+
+//function to read options from the command line into 'options'
+//prints an error and returns false if an option is not recognised
+bool parseOptions(int argc, char* argv[], ProgramOptions& options)
+{
+    for (int i{ 1 }; i < argc; ++i)
+    {
+        string option{ argv[i] };
+        //value of an option given as --name=value
+        string value{ option.find('=') == string::npos ? "" : option.substr(option.find('=') + 1) };
+
+        if (option == "--heap-nodes")
+        {
+            options.heapNodes = true;
+        }
+        else if (option == "--strict")
+        {
+            options.strictBatch = true;
+        }
+        else if (option == "--quiet")
+        {
+            options.quiet = true;
+        }
+        else if (option.rfind("--report=", 0) == 0 && !value.empty())
+        {
+            options.reportFile = value;
+        }
+        else if ((option == "--to-snapshot" || option == "--to-text") && i + 2 < argc)
+        {
+            //convert a database: --to-snapshot IN OUT or --to-text IN OUT
+            options.convert = true;
+            options.convertFormat = option == "--to-snapshot" ? DatabaseFormat::Snapshot : DatabaseFormat::Text;
+            options.convertInput = argv[++i];
+            options.convertOutput = argv[++i];
+        }
+        else if (option == "--generate" && i + 4 < argc && parseOptionNumber(argv[i + 1], options.generateRecords)
+            && parseOptionNumber(argv[i + 2], options.generateCommands))
+        {
+            //write a synthetic workload: --generate RECORDS COMMANDS DATABASE BATCHFILE
+            options.generate = true;
+            i += 2;
+            options.generateDatabase = argv[++i];
+            options.generateBatch = argv[++i];
+        }
+        else if (option.rfind("--mix=", 0) == 0 && parseCommandMix(value, options.commandMix))
+        {
+            //(the weights were stored as they were read)
+        }
+        else if (option.rfind("--seed=", 0) == 0 && parseOptionNumber(value, options.seed))
+        {
+            //(the seed was stored as it was read)
+        }
+        else if (option == "--benchmark")
+        {
+            options.benchmark = true;
+        }
+        else if (option == "--serve" || (option.rfind("--serve=", 0) == 0 && !value.empty()))
+        {
+            options.serve = true;
+            options.serveSocket = value;
+        }
+        else if (option.rfind("--save-every=", 0) == 0 && parseOptionNumber(value, options.saveSeconds))
+        {
+            //(the number of seconds was stored as it was read)
+        }
+        else if (option.rfind("--readers=", 0) == 0 && parseOptionNumber(value, options.readerThreads))
+        {
+            options.readerThreads = min(options.readerThreads, static_cast<unsigned int>(SharedRecords::maxReaders));
+        }
+        else if (option == "--check-reference")
+        {
+            options.referenceWorkloads = 3;
+        }
+        else if (option.rfind("--check-reference=", 0) == 0 && parseOptionNumber(value, options.referenceWorkloads)
+            && options.referenceWorkloads < 100000)
+        {
+            //(the number of workloads was stored as it was read)
+        }
+        else if (option == "--stress-readers")
+        {
+            options.stressSeconds = 1;
+        }
+        else if (option.rfind("--stress-readers=", 0) == 0 && parseOptionNumber(value, options.stressSeconds))
+        {
+            //(the number of seconds was stored as it was read)
+        }
+        else if (option == "--check-aggregates")
+        {
+            options.checkAggregates = true;
+        }
+        else if (option == "--check-allocations")
+        {
+#ifdef ARCADE_COUNT_ALLOCATIONS
+            options.checkAllocations = true;
+#else
+            cerr << "--check-allocations is not available: build the program with -DARCADE_COUNT_ALLOCATIONS to count allocations\n";
+            return false;
+#endif
+        }
+        else if (option == "--stream")
+        {
+            options.streamBytes = size_t{ 16 } << 20;
+        }
+        else if (option.rfind("--stream=", 0) == 0 && parseOptionNumber(value, options.streamBytes)
+            && options.streamBytes > 0 && options.streamBytes < 1000000)
+        {
+            //(the value is in megabytes)
+            options.streamBytes <<= 20;
+        }
+        else if (option == "--stats" || (option.rfind("--stats=", 0) == 0 && !value.empty()))
+        {
+#ifdef ARCADE_NO_STATS
+            cerr << "--stats is not available: this program was built with ARCADE_NO_STATS\n";
+            return false;
+#else
+            options.stats = true;
+            options.statsFile = value;
+#endif
+        }
+        else if (option == "--journal")
+        {
+            options.journal = true;
+        }
+        else if (option == "--compact")
+        {
+            options.journal = true;
+            options.compact = true;
+        }
+        else if (option == "--atomic-write")
+        {
+            options.atomicWrite = true;
+        }
+        else if (option.rfind("--load-threads=", 0) == 0 && parseOptionNumber(value, options.loadThreads))
+        {
+            //(the number of threads was stored as it was read)
+        }
+        else if (option.rfind("--shards=", 0) == 0 && parseOptionNumber(value, options.shards))
+        {
+            options.shards = min(options.shards, maxShards);
+        }
+        else
+        {
+            if (option == "--generate")
+            {
+                cerr << "--generate takes RECORDS COMMANDS DATABASE BATCHFILE, with RECORDS and COMMANDS whole numbers\n";
+            }
+            else
+            {
+                cerr << "unknown option: " << option << '\n';
+            }
+            cerr << "usage: " << argv[0] << " [--heap-nodes] [--load-threads=N] [--atomic-write] [--strict] [--quiet] [--report=FILE] [--journal] [--compact]\n"
+                << "       " << "    [--readers=N] [--stress-readers[=SECONDS]] [--check-aggregates] [--benchmark] [--stats[=FILE]]\n"
+                << "       " << "    [--stream[=MEGABYTES]] [--shards=N] [--serve[=SOCKET]] [--save-every=SECONDS] [--check-allocations]\n"
+                << "       " << argv[0] << " --generate RECORDS COMMANDS DATABASE BATCHFILE [--mix=ADD,SEARCH,EDIT,DELETE,SORT] [--seed=N]\n"
+                << "       " << argv[0] << " --check-reference[=WORKLOADS] [--mix=ADD,SEARCH,EDIT,DELETE,SORT] [--seed=N]\n"
+                << "       " << argv[0] << " [--journal] [--to-snapshot | --to-text] INPUT OUTPUT\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+//function to read the value of a numeric option (a count, or for the few options that take one, a number of seconds)
+//returns false unless the whole of 'text' is one number of the type: an empty value, a sign, anything after the number,
+//or a number too large for the type is refused, so the caller reports the option as not valid
+template <typename Number>
+bool parseOptionNumber(string_view text, Number& number)
+{
+    const char* end = text.data() + text.size();
+    Number value{};
+    auto result = from_chars(text.data(), end, value);
+    if (text.empty() || text[0] == '-' || result.ec != errc() || result.ptr != end)
+    {
+        return false;
+    }
+    if constexpr (is_floating_point_v<Number>)
+    {
+        //("inf" and "nan" read as numbers, but are no number of seconds)
+        if (!isfinite(value))
+        {
+            return false;
+        }
+    }
+    number = value;
+    return true;
+}
+
+//function to read the command mix of a generated workload ("ADD,SEARCH,EDIT,DELETE,SORT" weights) into 'mix'
+//returns false (leaving 'mix' alone) unless there are exactly five whole numbers
+bool parseCommandMix(const string& text, unsigned int mix[5])
+{
+    unsigned int weights[5];
+    size_t start{ 0 };
+    for (size_t i{ 0 }; i < 5; ++i)
+    {
+        size_t end{ i < 4 ? text.find(',', start) : text.size() };
+        if (end == string::npos || end - start > 6 || !parseOptionNumber(string_view(text).substr(start, end - start), weights[i]))
+        {
+            return false;
+        }
+        start = end + 1;
+    }
+    copy(weights, weights + 5, mix);
+    return true;
+}
+
+//function to convert string to lowercase, into 'lowercase'
+//'lowercase' keeps its capacity, so a buffer reused for every call stops allocating once it is big enough
+void toLowercase(string_view original, string& lowercase)
+{
+    lowercase.assign(original);
+
+    //loop through each character in string, converting it to its lowercase equivalent
+    for (char& character : lowercase)
+    {
+        character = static_cast<char>(tolower(static_cast<unsigned char>(character)));
+    }
+}
+
+//function to remove leading zeros from string (returns a view of the part of 'original' that is kept)
+string_view cutLeadingZeroes(string_view original) 
+{
+    //loop through each charactter in string
+    for (size_t i{ 0 }; i < original.size(); ++i)
+    {
+        //if current character isn't '0'
+        if (original[i] != '0')
+        {
+            //return view starting from this nonzero character to end of original string
+            return original.substr(i);
+        }
+    }
+    //if whole string is '0's or empty, return only one '0' to indicate value is zero
+    return "0";
+}
+
+//function to make the whole contents of a file available in memory
+//returns false if the file cannot be opened or read
+bool mapFile(const string& filename, MappedFile& file)
+{
+#ifndef _WIN32
+    int descriptor = open(filename.c_str(), O_RDONLY);
+    if (descriptor < 0)
+    {
+        return false;
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) != 0)
+    {
+        close(descriptor);
+        return false;
+    }
+    file.size = static_cast<size_t>(status.st_size);
+
+    //an empty file has nothing to map
+    if (file.size > 0)
+    {
+        void* mapping = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapping == MAP_FAILED)
+        {
+            close(descriptor);
+            return false;
+        }
+        //the file is read front to back, so ask for aggressive read-ahead
+        madvise(mapping, file.size, MADV_SEQUENTIAL);
+        file.mapping = mapping;
+        file.data = static_cast<const char*>(mapping);
+    }
+    close(descriptor);
+    return true;
+#else
+    //without mmap, read the whole file into memory in one go
+    ifstream input(filename, ios::in | ios::binary | ios::ate);
+    if (!input)
+    {
+        return false;
+    }
+    file.copy.resize(static_cast<size_t>(input.tellg()));
+    input.seekg(0);
+    input.read(file.copy.data(), static_cast<streamsize>(file.copy.size()));
+    file.size = file.copy.size();
+    file.data = file.copy.empty() ? nullptr : file.copy.data();
+    return true;
+#endif
+}
+
+//unmap file (if it was mapped) when the MappedFile goes away
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+    if (mapping != nullptr)
+    {
+        munmap(mapping, size);
+    }
+#endif
+}
+
+//function to get 'size' bytes of memory from the arena, starting at a multiple of 'alignment'
+void* allocateFromArena(StringArena& arena, size_t size, size_t alignment)
+{
+    //round start up to the alignment (blocks themselves start suitably aligned for anything)
+    size_t start{ (arena.used + alignment - 1) / alignment * alignment };
+
+    //start a new block if there is not enough room left in the last one
+    //(blocks are 64KB, or bigger if the request itself is bigger)
+    if (arena.blocks.empty() || start + size > arena.capacity)
+    {
+        size_t blockSize{ size > 65536 ? size : 65536 };
+        arena.blocks.push_back(unique_ptr<char[]>(new char[blockSize]));
+        arena.capacity = blockSize;
+        start = 0;
+    }
+    arena.used = start + size;
+    return arena.blocks.back().get() + start;
+}
+
+//function to copy text into the arena; the returned TextRef stays valid for as long as the arena exists
+TextRef storeText(StringArena& arena, string_view text)
+{
+    char* destination = static_cast<char*>(allocateFromArena(arena, text.size(), 1));
+    if (!text.empty())
+    {
+        text.copy(destination, text.size());
+    }
+    return TextRef{ destination, static_cast<unsigned int>(text.size()) };
+}
+
+//function to read the whole number at the start of text (leading whitespace and sign allowed, anything after the digits
+//ignored); text without a leading number gives 0, and a number past the range of a long long gives the nearest end of it
+long long parseInteger(string_view text)
+{
+    //skip leading whitespace and a leading '+', which from_chars does not accept
+    size_t start{ 0 };
+    while (start < text.size() && isspace(static_cast<unsigned char>(text[start])))
+    {
+        ++start;
+    }
+    if (start < text.size() && text[start] == '+')
+    {
+        ++start;
+    }
+
+    long long value{ 0 };
+    if (from_chars(text.data() + start, text.data() + text.size(), value).ec == errc::result_out_of_range)
+    {
+        value = text[start] == '-' ? numeric_limits<long long>::min() : numeric_limits<long long>::max();
+    }
+    return value;
+}
+
+//function to check whether text is exactly an amount with at most 2 decimals that don't need rounding
+//(digits, optional decimal point, then digits that are zero past the second), giving the amount in cents
+//trailing whitespace such as a '\r' left over from a Windows line ending is ignored
+bool exactCents(string_view text, long long& cents)
+{
+    size_t position{ 0 };
+    long long whole{ 0 };
+    int significantDigits{ 0 };
+
+    //read whole part (leading zeroes don't count towards the digit limit)
+    while (position < text.size() && isdigit(static_cast<unsigned char>(text[position])))
+    {
+        if (significantDigits > 0 || text[position] != '0')
+        {
+            ++significantDigits;
+        }
+        whole = whole * 10 + (text[position] - '0');
+        ++position;
+    }
+    //there must be at least one digit, and few enough that a double holds the amount exactly
+    if (position == 0 || significantDigits > 13)
+    {
+        return false;
+    }
+
+    //read up to two decimals; any more must all be zero
+    long long fraction{ 0 };
+    if (position < text.size() && text[position] == '.')
+    {
+        ++position;
+        for (int decimal{ 0 }; decimal < 2; ++decimal)
+        {
+            fraction *= 10;
+            if (position < text.size() && isdigit(static_cast<unsigned char>(text[position])))
+            {
+                fraction += text[position] - '0';
+                ++position;
+            }
+        }
+        while (position < text.size() && text[position] == '0')
+        {
+            ++position;
+        }
+    }
+    else
+    {
+        fraction = 0;
+    }
+
+    //only whitespace may follow
+    while (position < text.size() && isspace(static_cast<unsigned char>(text[position])))
+    {
+        ++position;
+    }
+    if (position != text.size())
+    {
+        return false;
+    }
+
+    cents = whole * 100 + fraction;
+    return true;
+}
+
+//function to read an amount of money (without the $) as a whole number of cents
+long long parseCents(string_view text)
+{
+    //most amounts are plain digits with up to two decimals, which convert exactly
+    long long cents{ 0 };
+    if (exactCents(text, cents))
+    {
+        return cents;
+    }
+
+    //anything else is read the way stod would read it, then rounded to the nearest cent
+    double value{ parseDouble(text) };
+    if (!(fabs(value) < 9.0e16))
+    {
+        return 0;
+    }
+    return llround(value * 100.0);
+}
+
+//function to read a number the way strtod does (text that isn't a number gives 0)
+//strtod needs a null-terminated string, so the text is copied onto the stack first (only very long text goes to the heap)
+double parseDouble(string_view text)
+{
+    char buffer[64];
+    if (text.size() < sizeof(buffer))
+    {
+        text.copy(buffer, text.size());
+        buffer[text.size()] = '\0';
+        return strtod(buffer, nullptr);
+    }
+    return strtod(string(text).c_str(), nullptr);
+}
+
+//function to format a whole number into 'buffer', returning number of characters written
+size_t formatInteger(long long value, char* buffer)
+{
+    return static_cast<size_t>(to_chars(buffer, buffer + 24, value).ptr - buffer);
+}
+
+//function to format an amount in cents (like 2499.75) into 'buffer', returning number of characters written
+size_t formatCents(long long cents, char* buffer)
+{
+    size_t size{ 0 };
+    unsigned long long magnitude = cents < 0 ? 0ULL - static_cast<unsigned long long>(cents) : static_cast<unsigned long long>(cents);
+    if (cents < 0)
+    {
+        buffer[size++] = '-';
+    }
+    size += static_cast<size_t>(to_chars(buffer + size, buffer + 24, magnitude / 100).ptr - (buffer + size));
+    buffer[size++] = '.';
+    buffer[size++] = static_cast<char>('0' + magnitude % 100 / 10);
+    buffer[size++] = static_cast<char>('0' + magnitude % 10);
+    return size;
+}
+
+//function to check whether a whole number prints as exactly this text (so the text doesn't need to be kept)
+bool integerPrintsAs(long long value, string_view text)
+{
+    //quick check for the usual case: plain digits with no leading zero
+    if (!text.empty() && text.size() < 19 && (text.size() == 1 || text[0] != '0'))
+    {
+        bool allDigits{ true };
+        for (char character : text)
+        {
+            allDigits = allDigits && isdigit(static_cast<unsigned char>(character));
+        }
+        if (allDigits)
+        {
+            return true;
+        }
+    }
+
+    //otherwise format the number and compare
+    char buffer[24];
+    return string_view(buffer, formatInteger(value, buffer)) == text;
+}
+
+//function to check whether an amount in cents prints as exactly this text (so the text doesn't need to be kept)
+bool centsPrintsAs(long long cents, string_view text)
+{
+    char buffer[24];
+    return string_view(buffer, formatCents(cents, buffer)) == text;
+}
+
+//function to get the RecordText of a node, creating an empty one if it does not have one yet
+RecordText& recordText(RecordList& list, GameData& node)
+{
+    if (node.text == nullptr)
+    {
+        node.text = new (allocateFromArena(list.arena, sizeof(RecordText), alignof(RecordText))) RecordText{};
+    }
+    return *node.text;
+}
+
+//function to remember the text of a field, or forget it again if the field's value already prints as that text
+void keepFieldText(RecordList& list, GameData& node, TextRef RecordText::* field, string_view text, bool printsSame)
+{
+    if (printsSame)
+    {
+        if (node.text != nullptr)
+        {
+            (node.text->*field) = TextRef{};
+        }
+    }
+    else
+    {
+        recordText(list, node).*field = storeText(list.arena, text);
+    }
+}
+
+//function to set a record's high score from the text that should be printed for it
+void setHighScore(RecordList& list, GameData& node, string_view text)
+{
+    node.highScore = parseInteger(text);
+    keepFieldText(list, node, &RecordText::highScore, text, integerPrintsAs(node.highScore, text));
+}
+
+//function to set a record's plays from the text that should be printed for it
+void setPlays(RecordList& list, GameData& node, string_view text)
+{
+    node.plays = parseInteger(text);
+    keepFieldText(list, node, &RecordText::plays, text, integerPrintsAs(node.plays, text));
+}
+
+//function to set a record's revenue from the text that should be printed for it (without the $)
+void setRevenue(RecordList& list, GameData& node, string_view text)
+{
+    node.revenue = parseCents(text);
+    keepFieldText(list, node, &RecordText::revenue, text, centsPrintsAs(node.revenue, text));
+}
+
+//function to set a record's revenue to a calculated amount, printed with two decimals
+void setRevenue(RecordList& list, GameData& node, double value)
+{
+    //format the same way the fixed/setprecision(2) stream formatting does
+    char buffer[512];
+    int size = snprintf(buffer, sizeof(buffer), "%.2f", value);
+    setRevenue(list, node, string_view(buffer, size > 0 ? static_cast<size_t>(size) : 0));
+}
+
+//function to set a record's initials, storing them inside the node when they fit
+void setInitials(RecordList& list, GameData& node, string_view text)
+{
+    bool fits{ text.size() < sizeof(node.initials) && text.find('\0') == string_view::npos };
+    node.initials[0] = '\0';
+    if (fits)
+    {
+        text.copy(node.initials, text.size());
+        node.initials[text.size()] = '\0';
+    }
+    keepFieldText(list, node, &RecordText::initials, text, fits);
+}
+
+//functions to get the text printed for each numeric field of a record
+FieldText highScoreText(const GameData& node)
+{
+    FieldText field;
+    if (node.text != nullptr && node.text->highScore.data != nullptr)
+    {
+        field.stored = node.text->highScore.data;
+        field.size = node.text->highScore.size;
+    }
+    else
+    {
+        field.size = formatInteger(node.highScore, field.digits);
+    }
+    return field;
+}
+
+FieldText playsText(const GameData& node)
+{
+    FieldText field;
+    if (node.text != nullptr && node.text->plays.data != nullptr)
+    {
+        field.stored = node.text->plays.data;
+        field.size = node.text->plays.size;
+    }
+    else
+    {
+        field.size = formatInteger(node.plays, field.digits);
+    }
+    return field;
+}
+
+FieldText revenueText(const GameData& node)
+{
+    FieldText field;
+    if (node.text != nullptr && node.text->revenue.data != nullptr)
+    {
+        field.stored = node.text->revenue.data;
+        field.size = node.text->revenue.size;
+    }
+    else
+    {
+        field.size = formatCents(node.revenue, field.digits);
+    }
+    return field;
+}
+
+//function to get the initials of a record
+string_view initialsText(const GameData& node)
+{
+    if (node.text != nullptr && node.text->initials.data != nullptr)
+    {
+        return node.text->initials.view();
+    }
+    return string_view(node.initials);
+}
+
+//each field a record can be sorted by, as a type: the type of its sort key, how to get the key from a record, and
+//(for numeric fields) which of RecordList::orderedIndexes is its ordered index (its place in orderedFields)
+//sorts and edits pick the specialization once per command, so their inner loops never check which field they are on
+template <SortKey field>
+struct RecordField;
+
+template <>
+struct RecordField<SortKey::Name>
+{
+    using Key = string_view;
+    static Key key(const GameData& node) { return node.name.view(); }
+};
+
+template <>
+struct RecordField<SortKey::Initials>
+{
+    using Key = string_view;
+    static Key key(const GameData& node) { return initialsText(node); }
+};
+
+template <>
+struct RecordField<SortKey::Plays>
+{
+    using Key = long long;
+    static const size_t orderedIndex = 0;
+    static Key key(const GameData& node) { return node.plays; }
+};
+
+template <>
+struct RecordField<SortKey::HighScore>
+{
+    using Key = long long;
+    static const size_t orderedIndex = 1;
+    static Key key(const GameData& node) { return node.highScore; }
+};
+
+template <>
+struct RecordField<SortKey::Revenue>
+{
+    using Key = long long;
+    static const size_t orderedIndex = 2;
+    static Key key(const GameData& node) { return node.revenue; }
+};
+
+//function to check whether record 'a' belongs strictly before record 'b' when sorting by 'field' (a RecordOrder)
+template <SortKey field, bool descending>
+bool recordBefore(const GameData& a, const GameData& b)
+{
+    return descending ? RecordField<field>::key(b) < RecordField<field>::key(a) : RecordField<field>::key(a) < RecordField<field>::key(b);
+}
+
+//function to print a numeric field's text to a stream
+ostream& operator<<(ostream& out, const FieldText& field)
+{
+    return out << field.view();
+}
+
+//hash of a name that ignores case (FNV-1a over the lowercase characters)
+size_t hashNameIgnoreCase(string_view name)
+{
+    size_t hash{ 14695981039346656037ULL };
+    for (char character : name)
+    {
+        hash ^= static_cast<unsigned char>(tolower(static_cast<unsigned char>(character)));
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+//comparison of two names that ignores case
+bool equalsIgnoreCase(string_view a, string_view b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (size_t i{ 0 }; i < a.size(); ++i)
+    {
+        if (tolower(static_cast<unsigned char>(a[i])) != tolower(static_cast<unsigned char>(b[i])))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//function to make sure the name index can hold 'count' names while staying at most half full
+void reserveNames(NameIndex& index, size_t count)
+{
+    size_t wanted{ 16 };
+    while (wanted < count * 2)
+    {
+        wanted *= 2;
+    }
+    if (wanted <= index.slots.size())
+    {
+        return;
+    }
+
+    //move every chain into a bigger array of slots, at the position its hash now probes from
+    vector<NameSlot> oldSlots(wanted);
+    oldSlots.swap(index.slots);
+    size_t mask{ index.slots.size() - 1 };
+    for (const NameSlot& slot : oldSlots)
+    {
+        if (slot.chain != nullptr)
+        {
+            size_t position{ slot.hash & mask };
+            while (index.slots[position].chain != nullptr)
+            {
+                position = (position + 1) & mask;
+            }
+            index.slots[position] = slot;
+        }
+    }
+}
+
+//function to find the slot holding the chain for a name (whose hash is 'hash')
+//returns string::npos if no node has that name
+size_t findNameSlot(const NameIndex& index, string_view name, size_t hash)
+{
+    if (index.slots.empty())
+    {
+        return string::npos;
+    }
+
+    //probe forward from the hash's slot until we find the name or reach an unused slot
+    size_t mask{ index.slots.size() - 1 };
+    for (size_t position{ hash & mask }; index.slots[position].chain != nullptr; position = (position + 1) & mask)
+    {
+        const NameSlot& slot = index.slots[position];
+        if (slot.hash == hash && equalsIgnoreCase(slot.chain->name.view(), name))
+        {
+            return position;
+        }
+    }
+    return string::npos;
+}
+
+//function to get the chain for a name, giving it an (empty) slot first if the name is not in the index yet
+GameData*& addNameChain(NameIndex& index, string_view name, size_t hash)
+{
+    size_t existing{ findNameSlot(index, name, hash) };
+    if (existing != string::npos)
+    {
+        return index.slots[existing].chain;
+    }
+
+    //grow first if needed, then claim first unused slot at or after the hash's slot
+    reserveNames(index, index.used + 1);
+    size_t mask{ index.slots.size() - 1 };
+    size_t position{ hash & mask };
+    while (index.slots[position].chain != nullptr)
+    {
+        position = (position + 1) & mask;
+    }
+    ++index.used;
+    index.slots[position].hash = hash;
+    return index.slots[position].chain;
+}
+
+//function to give up a slot whose chain has become empty
+void removeNameSlot(NameIndex& index, size_t hole)
+{
+    size_t mask{ index.slots.size() - 1 };
+    index.slots[hole] = NameSlot{};
+    --index.used;
+
+    //shift later slots of the same probe run back into the hole, so probing never stops early at it
+    for (size_t position{ (hole + 1) & mask }; index.slots[position].chain != nullptr; position = (position + 1) & mask)
+    {
+        size_t home{ index.slots[position].hash & mask };
+        //slot may move into hole only if hole lies between its home slot and where it is now
+        bool canMove = (hole <= position) ? (home <= hole || home > position) : (home <= hole && home > position);
+        if (canMove)
+        {
+            index.slots[hole] = index.slots[position];
+            index.slots[position] = NameSlot{};
+            hole = position;
+        }
+    }
+}
+
+#ifdef ARCADE_CONTIGUOUS_STORE
+//function to get the record at a position of the store
+GameData& recordAt(const RecordStore& store, size_t position)
+{
+    return store.slabs[position / RecordStore::slabSize][position % RecordStore::slabSize];
+}
+
+//function to get the first record at or after a position of the store, skipping tombstones (nullptr if there is none)
+GameData* recordFrom(const RecordStore& store, size_t position)
+{
+    while (position < store.used && store.live[position] == 0)
+    {
+        ++position;
+    }
+    return position < store.used ? &recordAt(store, position) : nullptr;
+}
+
+//function to forget everything that pointed at records by where they are, once records have been moved
+//(the name, search and ordered indexes are rebuilt when next needed, and concurrent readers get a view copied afresh)
+void forgetRecordPositions(RecordList& list)
+{
+    //the indexes keep their memory, so rebuilding them allocates nothing
+    list.nameIndex.slots.assign(list.nameIndex.slots.size(), NameSlot{});
+    list.nameIndex.used = 0;
+    list.nameIndex.built = false;
+    clearSearchIndex(list.searchIndex, false);
+    clearOrderedIndexes(list);
+    list.columns.built = false;
+    if (list.shared != nullptr)
+    {
+        list.shared->rebuild = true;
+    }
+}
+
+//function to squeeze the tombstones out of the store, moving every record after one down (keeping list order)
+void compactRecords(RecordList& list)
+{
+    RecordStore& store = list.store;
+    if (store.tombstones == 0)
+    {
+        return;
+    }
+    size_t kept{ 0 };
+    for (size_t position{ 0 }; position < store.used; ++position)
+    {
+        if (store.live[position] != 0)
+        {
+            if (kept != position)
+            {
+                recordAt(store, kept) = recordAt(store, position);
+            }
+            recordAt(store, kept).order = kept;
+            ++kept;
+        }
+    }
+    //slabs left empty are kept for the records added next
+    store.used = kept;
+    store.live.assign(kept, 1);
+    store.tombstones = 0;
+    forgetRecordPositions(list);
+}
+
+//function to move the records of a store without tombstones into a new order: the record at each position comes
+//from position source[position]; each cycle of the permutation is followed round once, so every record moves once
+void permuteRecords(RecordList& list, const vector<size_t>& source)
+{
+    RecordStore& store = list.store;
+    vector<bool> placed(source.size(), false);
+    for (size_t start{ 0 }; start < source.size(); ++start)
+    {
+        if (placed[start])
+        {
+            continue;
+        }
+        GameData held = recordAt(store, start);
+        size_t position{ start };
+        while (source[position] != start)
+        {
+            recordAt(store, position) = recordAt(store, source[position]);
+            placed[position] = true;
+            position = source[position];
+        }
+        recordAt(store, position) = held;
+        placed[position] = true;
+    }
+    for (size_t position{ 0 }; position < source.size(); ++position)
+    {
+        recordAt(store, position).order = position;
+    }
+    forgetRecordPositions(list);
+}
+#else
+//function to get memory for one node from the pool; the node starts with every field zero/empty
+GameData* allocateNode(NodePool& pool)
+{
+    //when comparing against plain heap allocation, every node is its own allocation
+    if (pool.useHeap)
+    {
+        return new GameData{};
+    }
+
+    GameData* node = nullptr;
+    //reuse a deleted node if there is one
+    if (pool.freeNodes != nullptr)
+    {
+        node = pool.freeNodes;
+        pool.freeNodes = node->next;
+    }
+    //otherwise take the next unused node of the last slab, starting a new slab when it is full
+    else
+    {
+        if (pool.used == pool.capacity)
+        {
+            const size_t slabSize{ 4096 };
+            pool.slabs.push_back(unique_ptr<GameData[]>(new GameData[slabSize]));
+            pool.used = 0;
+            pool.capacity = slabSize;
+        }
+        node = &pool.slabs.back()[pool.used++];
+    }
+    *node = GameData{};
+    return node;
+}
+
+//function to give a node back to the pool (it is reused by a later allocateNode)
+void freeNode(NodePool& pool, GameData* node)
+{
+    if (pool.useHeap)
+    {
+        delete node;
+        return;
+    }
+    node->next = pool.freeNodes;
+    pool.freeNodes = node;
+}
+#endif
+
+//function to get memory for a new record (not in the list yet); the record starts with every field zero/empty
+GameData* allocateRecord(RecordList& list)
+{
+#ifdef ARCADE_CONTIGUOUS_STORE
+    //records are only ever appended, so a new record takes the next position at the end of the store
+    RecordStore& store = list.store;
+    if (store.used == store.slabs.size() * RecordStore::slabSize)
+    {
+        store.slabs.push_back(unique_ptr<GameData[]>(new GameData[RecordStore::slabSize]));
+    }
+    GameData* node = &recordAt(store, store.used);
+    *node = GameData{};
+    node->order = store.used++;
+    store.live.push_back(0);
+    return node;
+#else
+    return allocateNode(list.pool);
+#endif
+}
+
+//function to give back the memory of a record that has been unlinked from the list
+void freeRecord(RecordList& list, GameData* node)
+{
+#ifdef ARCADE_CONTIGUOUS_STORE
+    //its position stays a tombstone; once tombstones outnumber the records, squeeze them all out at once
+    (void)node;
+    if (list.store.tombstones > RecordStore::slabSize && list.store.tombstones > list.size)
+    {
+        compactRecords(list);
+    }
+#else
+    freeNode(list.pool, node);
+#endif
+}
+
+//functions to walk the records in list order:
+//for (GameData* node = firstRecord(list); node != nullptr; node = nextRecord(list, node))
+GameData* firstRecord(const RecordList& list)
+{
+#ifdef ARCADE_CONTIGUOUS_STORE
+    return recordFrom(list.store, 0);
+#else
+    return list.head;
+#endif
+}
+
+GameData* nextRecord(const RecordList& list, const GameData* node)
+{
+#ifdef ARCADE_CONTIGUOUS_STORE
+    return recordFrom(list.store, static_cast<size_t>(node->order) + 1);
+#else
+    (void)list;
+    return node->next;
+#endif
+}
+
+//function to get the last record in list order (nullptr when the list is empty)
+GameData* lastRecord(const RecordList& list)
+{
+#ifdef ARCADE_CONTIGUOUS_STORE
+    //skip back over any tombstones at the end of the store
+    for (size_t position{ list.store.used }; position > 0; --position)
+    {
+        if (list.store.live[position - 1] != 0)
+        {
+            return &recordAt(list.store, position - 1);
+        }
+    }
+    return nullptr;
+#else
+    return list.tail;
+#endif
+}
+
+//function to free every record of the list at once, leaving an empty list
+void freeAllRecords(RecordList& list)
+{
+#ifdef ARCADE_CONTIGUOUS_STORE
+    //records go away with their slabs
+    list.store = RecordStore{};
+#else
+    //nodes from the heap have to be deleted one by one; pooled nodes go away with their slabs
+    if (list.pool.useHeap)
+    {
+        GameData* node = list.head;
+        while (node != nullptr)
+        {
+            GameData* next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+    list.pool.slabs.clear();
+    list.pool.used = 0;
+    list.pool.capacity = 0;
+    list.pool.freeNodes = nullptr;
+    list.head = nullptr;
+    list.tail = nullptr;
+#endif
+
+    //forget the nodes and everything that pointed at them, then release the text they used
+    list.size = 0;
+    list.nameIndex.slots.clear();
+    list.nameIndex.used = 0;
+    list.nameIndex.built = false;
+    clearSearchIndex(list.searchIndex, true);
+    clearOrderedIndexes(list);
+    RecordColumns columns;
+    columns.check = list.columns.check;
+    columns.mismatches = list.columns.mismatches;
+    list.columns = move(columns);
+    list.arena.blocks.clear();
+    list.arena.used = 0;
+    list.arena.capacity = 0;
+}
+
+//function to create a new, unlinked record with the given name; all other fields start at zero/empty
+GameData* newRecord(RecordList& list, string_view name)
+{
+    GameData* node = allocateRecord(list);
+    node->name = storeText(list.arena, name);
+    return node;
+}
+
+//function to append a copy of a record from another list (its text is copied into this list's arena)
+GameData* copyRecord(RecordList& list, const GameData& node)
+{
+    GameData* copy = newRecord(list, node.name.view());
+    copy->highScore = node.highScore;
+    copy->plays = node.plays;
+    copy->revenue = node.revenue;
+    memcpy(copy->initials, node.initials, sizeof(copy->initials));
+    if (node.text != nullptr)
+    {
+        //text that isn't stored stays that way (an empty TextRef means the field prints as its number)
+        auto copyText = [&list](TextRef text) { return text.data == nullptr ? TextRef{} : storeText(list.arena, text.view()); };
+        RecordText& text = recordText(list, *copy);
+        text.highScore = copyText(node.text->highScore);
+        text.plays = copyText(node.text->plays);
+        text.revenue = copyText(node.text->revenue);
+        text.initials = copyText(node.text->initials);
+    }
+    appendNode(list, copy);
+    return copy;
+}
+
+//function to build the name index from every node in the list (does nothing if it is already built)
+void buildNameIndex(RecordList& list)
+{
+    if (list.nameIndex.built)
+    {
+        return;
+    }
+    list.nameIndex.built = true;
+    reserveNames(list.nameIndex, list.size);
+
+    //work out each hash a few nodes ahead of inserting the node, so the slot it goes into can be prefetched first;
+    //slots are scattered, and would otherwise miss cache every time (the nodes waiting to be inserted are kept in a
+    //small ring on the stack, so rebuilding the index allocates nothing)
+    const size_t lookAhead{ 16 };
+    GameData* waiting[lookAhead];
+    size_t hashes[lookAhead];
+    size_t mask{ list.nameIndex.slots.size() - 1 };
+    auto insert = [&list](GameData* node, size_t hash)
+    {
+        GameData*& chain = addNameChain(list.nameIndex, node->name.view(), hash);
+        node->nextSameName = chain;
+        chain = node;
+    };
+    size_t count{ 0 };
+    for (GameData* node = firstRecord(list); node != nullptr; node = nextRecord(list, node), ++count)
+    {
+        size_t hash{ hashNameIgnoreCase(node->name.view()) };
+#if defined(__GNUC__)
+        __builtin_prefetch(&list.nameIndex.slots[hash & mask]);
+#endif
+        if (count >= lookAhead)
+        {
+            insert(waiting[count % lookAhead], hashes[count % lookAhead]);
+        }
+        waiting[count % lookAhead] = node;
+        hashes[count % lookAhead] = hash;
+    }
+    for (size_t i{ count > lookAhead ? count - lookAhead : 0 }; i < count; ++i)
+    {
+        insert(waiting[i % lookAhead], hashes[i % lookAhead]);
+    }
+}
+
+//function to append a node to end of list and add it to the name index
+void appendNode(RecordList& list, GameData* node)
+{
+#ifdef ARCADE_CONTIGUOUS_STORE
+    //node already sits at the end of the store; its position now holds a record
+    list.store.live[node->order] = 1;
+#else
+    //link node in after current tail (or make it the head if list is empty)
+    node->next = nullptr;
+    node->prev = list.tail;
+    node->order = list.nextOrder++;
+    if (list.tail == nullptr)
+    {
+        list.head = node;
+    }
+    else
+    {
+        list.tail->next = node;
+    }
+    list.tail = node;
+#endif
+    ++list.size;
+
+    //put node at front of the chain for its name, so it can be found without walking the list
+    if (list.nameIndex.built)
+    {
+        GameData*& chain = addNameChain(list.nameIndex, node->name.view(), hashNameIgnoreCase(node->name.view()));
+        node->nextSameName = chain;
+        chain = node;
+    }
+
+    //list node under the trigrams of its name, so searches can find it
+    if (list.searchIndex.built)
+    {
+        addSearchNode(list.searchIndex, node);
+    }
+
+    //put node in its place in the ordered indexes (after every record with the same value, since it comes last)
+    addToOrderedIndexes(list, node);
+
+    //concurrent readers get the new record with the next published view; columns are copied afresh when next needed
+    list.columns.built = false;
+    if (list.shared != nullptr)
+    {
+        list.shared->pending.push_back(PendingChange{ PendingChange::Added, node, node->order });
+    }
+}
+
+//function to take a node out of the list and the name index (the node itself is not freed)
+void unlinkNode(RecordList& list, GameData* node)
+{
+#ifdef ARCADE_CONTIGUOUS_STORE
+    //leave a tombstone at node's position (squeezed out later by freeRecord, or by the next sort)
+    list.store.live[node->order] = 0;
+    ++list.store.tombstones;
+#else
+    //point neighbours at each other, skipping over node (or move head/tail if node was at an end)
+    if (node->prev == nullptr)
+    {
+        list.head = node->next;
+    }
+    else
+    {
+        node->prev->next = node->next;
+    }
+    if (node->next == nullptr)
+    {
+        list.tail = node->prev;
+    }
+    else
+    {
+        node->next->prev = node->prev;
+    }
+#endif
+    --list.size;
+    list.columns.built = false;
+    if (list.shared != nullptr)
+    {
+        list.shared->pending.push_back(PendingChange{ PendingChange::Removed, nullptr, node->order });
+    }
+
+    //take node out of the ordered indexes (with the values it was put in under)
+    removeFromOrderedIndexes(list, node);
+
+    //blank node out of the search index; once most of the index is blanked out, drop it (it is rebuilt by the next search)
+    if (list.searchIndex.built)
+    {
+        list.searchIndex.nodes[node->searchId] = nullptr;
+        ++list.searchIndex.deleted;
+        if (list.searchIndex.deleted > 1024 && list.searchIndex.deleted * 2 > list.searchIndex.nodes.size())
+        {
+            clearSearchIndex(list.searchIndex, false);
+        }
+    }
+
+    //remove node from the chain for its name, dropping the index entry once the chain is empty
+    if (!list.nameIndex.built)
+    {
+        return;
+    }
+    size_t slot{ findNameSlot(list.nameIndex, node->name.view(), hashNameIgnoreCase(node->name.view())) };
+    GameData** link = &list.nameIndex.slots[slot].chain;
+    while (*link != node)
+    {
+        link = &(*link)->nextSameName;
+    }
+    *link = node->nextSameName;
+    if (list.nameIndex.slots[slot].chain == nullptr)
+    {
+        removeNameSlot(list.nameIndex, slot);
+    }
+}
+
+//function to find the first node in list order whose name matches exactly (case-sensitive)
+//returns nullptr if there is no such node
+GameData* findFirstByName(RecordList& list, string_view name)
+{
+    buildNameIndex(list);
+    size_t slot{ findNameSlot(list.nameIndex, name, hashNameIgnoreCase(name)) };
+    if (slot == string::npos)
+    {
+        return nullptr;
+    }
+
+    //chain holds every case variation of the name; pick the exact match nearest the head
+    GameData* first = nullptr;
+    size_t visited{ 0 };
+    for (GameData* node = list.nameIndex.slots[slot].chain; node != nullptr; node = node->nextSameName)
+    {
+        ++visited;
+        if (node->name.view() == name && (first == nullptr || node->order < first->order))
+        {
+            first = node;
+        }
+    }
+    countVisited(list, visited);
+    return first;
+}
+
+//function to find the first node in list order whose name matches ignoring case
+//returns nullptr if there is no such node
+GameData* findFirstByNameIgnoreCase(RecordList& list, string_view name)
+{
+    buildNameIndex(list);
+    size_t slot{ findNameSlot(list.nameIndex, name, hashNameIgnoreCase(name)) };
+    if (slot == string::npos)
+    {
+        return nullptr;
+    }
+
+    //pick the node nearest the head
+    GameData* first = nullptr;
+    size_t visited{ 0 };
+    for (GameData* node = list.nameIndex.slots[slot].chain; node != nullptr; node = node->nextSameName)
+    {
+        ++visited;
+        if (first == nullptr || node->order < first->order)
+        {
+            first = node;
+        }
+    }
+    countVisited(list, visited);
+    return first;
+}
+
+//function to get the search index bucket of a trigram (three characters in a row of a name, any case)
+unsigned int trigramBucket(char first, char second, char third)
+{
+    unsigned int trigram{ static_cast<unsigned int>(tolower(static_cast<unsigned char>(first))) << 16
+        | static_cast<unsigned int>(tolower(static_cast<unsigned char>(second))) << 8
+        | static_cast<unsigned int>(tolower(static_cast<unsigned char>(third))) };
+    return (trigram * 2654435761u) >> (32 - SearchIndex::bucketBits);
+}
+
+//function to give a node the next search id and list it under every trigram of its name
+void addSearchNode(SearchIndex& index, GameData* node)
+{
+    unsigned int id{ static_cast<unsigned int>(index.nodes.size()) };
+    node->searchId = id;
+    index.nodes.push_back(node);
+
+    string_view name{ node->name.view() };
+    for (size_t i{ 0 }; i + 3 <= name.size(); ++i)
+    {
+        //a name can have the same trigram (or two trigrams in the same bucket) more than once; list the node only once
+        vector<unsigned int>& bucket = index.buckets[trigramBucket(name[i], name[i + 1], name[i + 2])];
+        if (bucket.empty() || bucket.back() != id)
+        {
+            bucket.push_back(id);
+        }
+    }
+}
+
+//function to throw away the search index (it is rebuilt the next time a search needs it)
+//with 'release' its memory goes too; otherwise the buckets are only emptied, and rebuilding fits in the memory they
+//already have (every record still in the list was listed in them), so rebuilding allocates nothing
+void clearSearchIndex(SearchIndex& index, bool release)
+{
+    index.nodes.clear();
+    if (release)
+    {
+        index.nodes.shrink_to_fit();
+        index.buckets.clear();
+        index.buckets.shrink_to_fit();
+    }
+    else
+    {
+        for (vector<unsigned int>& bucket : index.buckets)
+        {
+            bucket.clear();
+        }
+    }
+    index.deleted = 0;
+    index.built = false;
+}
+
+//function to build the search index from every node in the list (does nothing if it is already built)
+void buildSearchIndex(RecordList& list)
+{
+    if (list.searchIndex.built)
+    {
+        return;
+    }
+    list.searchIndex.built = true;
+    list.searchIndex.buckets.resize(size_t{ 1 } << SearchIndex::bucketBits);
+    list.searchIndex.nodes.reserve(list.size);
+    for (GameData* node = firstRecord(list); node != nullptr; node = nextRecord(list, node))
+    {
+        addSearchNode(list.searchIndex, node);
+    }
+}
+
+//function to check whether a name contains a (lowercase) search term, ignoring case
+//gives the same answer as toLowercase(name).find(lowercaseTerm) != string::npos, without copying the name
+bool containsIgnoreCase(string_view name, string_view lowercaseTerm)
+{
+    if (lowercaseTerm.size() > name.size())
+    {
+        return false;
+    }
+    for (size_t start{ 0 }; start + lowercaseTerm.size() <= name.size(); ++start)
+    {
+        size_t i{ 0 };
+        while (i < lowercaseTerm.size()
+            && static_cast<char>(tolower(static_cast<unsigned char>(name[start + i]))) == lowercaseTerm[i])
+        {
+            ++i;
+        }
+        if (i == lowercaseTerm.size())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+//function to find every node whose name contains a (lowercase) search term, ignoring case
+//'matches' gets the nodes in list order, exactly as walking the list and checking every name would find them
+void findNamesContaining(RecordList& list, string_view lowercaseTerm, vector<GameData*>& matches)
+{
+    matches.clear();
+
+    //terms shorter than a trigram can't use the index; check every name (without copying any of them)
+    if (lowercaseTerm.size() < 3)
+    {
+        for (GameData* node = firstRecord(list); node != nullptr; node = nextRecord(list, node))
+        {
+            if (containsIgnoreCase(node->name.view(), lowercaseTerm))
+            {
+                matches.push_back(node);
+            }
+        }
+        countVisited(list, list.size);
+        return;
+    }
+
+    //every name containing the term contains all of its trigrams, so the nodes listed under the
+    //term's rarest trigram are the only ones that need checking
+    buildSearchIndex(list);
+    const vector<unsigned int>* rarest = nullptr;
+    for (size_t i{ 0 }; i + 3 <= lowercaseTerm.size(); ++i)
+    {
+        const vector<unsigned int>& bucket = list.searchIndex.buckets[trigramBucket(lowercaseTerm[i], lowercaseTerm[i + 1], lowercaseTerm[i + 2])];
+        if (rarest == nullptr || bucket.size() < rarest->size())
+        {
+            rarest = &bucket;
+        }
+    }
+    for (unsigned int id : *rarest)
+    {
+        GameData* node = list.searchIndex.nodes[id];
+        if (node != nullptr && containsIgnoreCase(node->name.view(), lowercaseTerm))
+        {
+            matches.push_back(node);
+        }
+    }
+    countVisited(list, rarest->size());
+
+    //search ids follow the order nodes were indexed in, not list order (sorting changes that), so put matches back in list order
+    sort(matches.begin(), matches.end(), [](const GameData* a, const GameData* b) { return a->order < b->order; });
+}
+
+//function to get the ordered index of a field (nullptr for fields without one: name and initials)
+OrderedIndex* orderedIndexFor(RecordList& list, SortKey field)
+{
+    for (size_t i{ 0 }; i < sizeof(orderedFields) / sizeof(orderedFields[0]); ++i)
+    {
+        if (orderedFields[i] == field)
+        {
+            return &list.orderedIndexes[i];
+        }
+    }
+    return nullptr;
+}
+
+//function to check whether ordered index entry 'a' comes before 'b': smaller value, or the same value and nearer the head
+bool entryBefore(const OrderedEntry& a, const OrderedEntry& b)
+{
+    return a.value < b.value || (a.value == b.value && a.order < b.order);
+}
+
+//function to find the block of an ordered index where 'key' belongs: the first block whose last entry does not come
+//before it (or the last block, if they all do); the index must have at least one block
+size_t findOrderedBlock(const OrderedIndex& index, const OrderedEntry& key)
+{
+    size_t low{ 0 };
+    size_t high{ index.blocks.size() - 1 };
+    while (low < high)
+    {
+        size_t middle{ low + (high - low) / 2 };
+        if (entryBefore(index.blocks[middle].back(), key))
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+//function to add a record to an ordered index, with its value of the indexed field
+void addOrderedEntry(OrderedIndex& index, long long value, GameData* node)
+{
+    OrderedEntry entry{ value, node->order, node };
+    if (index.blocks.empty())
+    {
+        index.blocks.emplace_back();
+        index.blocks.back().reserve(2 * OrderedIndex::blockSize);
+        index.blocks.back().push_back(entry);
+        return;
+    }
+    size_t block{ findOrderedBlock(index, entry) };
+    vector<OrderedEntry>& entries = index.blocks[block];
+    entries.insert(lower_bound(entries.begin(), entries.end(), entry, entryBefore), entry);
+
+    //split a full block in two, so adding an entry never moves more than 2*blockSize others
+    if (entries.size() >= 2 * OrderedIndex::blockSize)
+    {
+        vector<OrderedEntry> upper;
+        upper.reserve(2 * OrderedIndex::blockSize);
+        upper.assign(entries.begin() + OrderedIndex::blockSize, entries.end());
+        entries.resize(OrderedIndex::blockSize);
+        index.blocks.insert(index.blocks.begin() + static_cast<ptrdiff_t>(block) + 1, move(upper));
+    }
+}
+
+//function to take a record out of an ordered index ('value' is its value of the indexed field when it was added)
+void removeOrderedEntry(OrderedIndex& index, long long value, const GameData* node)
+{
+    if (index.blocks.empty())
+    {
+        return;
+    }
+    OrderedEntry key{ value, node->order, nullptr };
+    size_t block{ findOrderedBlock(index, key) };
+    vector<OrderedEntry>& entries = index.blocks[block];
+    auto place = lower_bound(entries.begin(), entries.end(), key, entryBefore);
+    if (place == entries.end() || place->node != node)
+    {
+        return;
+    }
+    entries.erase(place);
+    if (entries.empty())
+    {
+        index.blocks.erase(index.blocks.begin() + static_cast<ptrdiff_t>(block));
+    }
+}
+
+//function to add a record to every ordered index that is built (once the record's fields are set)
+void addToOrderedIndexes(RecordList& list, GameData* node)
+{
+    for (size_t i{ 0 }; i < sizeof(orderedFields) / sizeof(orderedFields[0]); ++i)
+    {
+        if (list.orderedIndexes[i].built)
+        {
+            addOrderedEntry(list.orderedIndexes[i], fieldValue(*node, orderedFields[i]), node);
+        }
+    }
+}
+
+//function to take a record out of every ordered index that is built (before its fields change, or it is unlinked)
+void removeFromOrderedIndexes(RecordList& list, const GameData* node)
+{
+    for (size_t i{ 0 }; i < sizeof(orderedFields) / sizeof(orderedFields[0]); ++i)
+    {
+        if (list.orderedIndexes[i].built)
+        {
+            removeOrderedEntry(list.orderedIndexes[i], fieldValue(*node, orderedFields[i]), node);
+        }
+    }
+}
+
+//functions to take a record out of one numeric field's ordered index before the field changes, and put it back after
+//(an edit only moves the record in the indexes of the fields it changes)
+template <SortKey field>
+void removeFromOrderedIndex(RecordList& list, const GameData* node)
+{
+    OrderedIndex& index = list.orderedIndexes[RecordField<field>::orderedIndex];
+    if (index.built)
+    {
+        removeOrderedEntry(index, RecordField<field>::key(*node), node);
+    }
+}
+
+template <SortKey field>
+void addToOrderedIndex(RecordList& list, GameData* node)
+{
+    OrderedIndex& index = list.orderedIndexes[RecordField<field>::orderedIndex];
+    if (index.built)
+    {
+        addOrderedEntry(index, RecordField<field>::key(*node), node);
+    }
+}
+
+//function to drop every ordered index (each is built again when next needed)
+void clearOrderedIndexes(RecordList& list)
+{
+    for (OrderedIndex& index : list.orderedIndexes)
+    {
+        index.blocks.clear();
+        index.built = false;
+    }
+}
+
+//function to fill an ordered index with entries that are already in order, cutting them into blocks
+void fillOrderedIndex(OrderedIndex& index, const vector<OrderedEntry>& entries)
+{
+    index.blocks.clear();
+    for (size_t start{ 0 }; start < entries.size(); start += OrderedIndex::blockSize)
+    {
+        size_t end{ min(start + OrderedIndex::blockSize, entries.size()) };
+        index.blocks.emplace_back();
+        index.blocks.back().reserve(2 * OrderedIndex::blockSize);
+        index.blocks.back().assign(entries.begin() + static_cast<ptrdiff_t>(start), entries.begin() + static_cast<ptrdiff_t>(end));
+    }
+    index.built = true;
+}
+
+//function to turn items in order of value round, keeping items with the same value in the order they were in
+//(ascending order becomes what a stable descending sort gives, and the other way round)
+template <typename Item, typename Value>
+void reverseKeepingTies(vector<Item>& items, Value valueOf)
+{
+    reverse(items.begin(), items.end());
+    for (size_t first{ 0 }; first < items.size(); )
+    {
+        size_t end{ first + 1 };
+        while (end < items.size() && valueOf(items[end]) == valueOf(items[first]))
+        {
+            ++end;
+        }
+        reverse(items.begin() + static_cast<ptrdiff_t>(first), items.begin() + static_cast<ptrdiff_t>(end));
+        first = end;
+    }
+}
+
+//function to build the ordered index of a field from every record in the list (does nothing if it is already built)
+void buildOrderedIndex(RecordList& list, SortKey field)
+{
+    OrderedIndex* index = orderedIndexFor(list, field);
+    if (index == nullptr || index->built)
+    {
+        return;
+    }
+    vector<OrderedEntry> entries;
+    entries.reserve(list.size);
+    for (GameData* node = firstRecord(list); node != nullptr; node = nextRecord(list, node))
+    {
+        entries.push_back(OrderedEntry{ fieldValue(*node, field), node->order, node });
+    }
+    sort(entries.begin(), entries.end(), entryBefore);
+    fillOrderedIndex(*index, entries);
+}
+
+//function to build the ordered index of the field a list has just been sorted by, straight from the list
+//(the records are in order of the field already, so this is one pass instead of a sort)
+void indexSortedList(RecordList& list, SortKey field, bool descending)
+{
+    OrderedIndex* index = orderedIndexFor(list, field);
+    if (index == nullptr)
+    {
+        return;
+    }
+    vector<OrderedEntry> entries;
+    entries.reserve(list.size);
+    for (GameData* node = firstRecord(list); node != nullptr; node = nextRecord(list, node))
+    {
+        entries.push_back(OrderedEntry{ fieldValue(*node, field), node->order, node });
+    }
+    if (descending)
+    {
+        reverseKeepingTies(entries, [](const OrderedEntry& entry) { return entry.value; });
+    }
+    fillOrderedIndex(*index, entries);
+}
+
+//function to collect the entries of an ordered index whose value is from 'low' to 'high' (inclusive), smallest value
+//first or largest value first; entries with the same value come in list order either way
+void collectOrdered(OrderedIndex& index, long long low, long long high, bool descending, vector<OrderedEntry*>& entries)
+{
+    entries.clear();
+    if (index.blocks.empty() || low > high)
+    {
+        return;
+    }
+
+    //start at the first entry with a value of at least 'low', and take entries until their value passes 'high'
+    OrderedEntry key{ low, 0, nullptr };
+    size_t block{ findOrderedBlock(index, key) };
+    size_t position{ static_cast<size_t>(lower_bound(index.blocks[block].begin(), index.blocks[block].end(), key, entryBefore)
+        - index.blocks[block].begin()) };
+    bool passed{ false };
+    for (; block < index.blocks.size() && !passed; ++block, position = 0)
+    {
+        vector<OrderedEntry>& blockEntries = index.blocks[block];
+        for (; position < blockEntries.size(); ++position)
+        {
+            if (blockEntries[position].value > high)
+            {
+                passed = true;
+                break;
+            }
+            entries.push_back(&blockEntries[position]);
+        }
+    }
+    if (descending)
+    {
+        reverseKeepingTies(entries, [](const OrderedEntry* entry) { return entry->value; });
+    }
+}
+
+//function to put the list in order of a field by walking the field's ordered index, instead of comparing records
+//the index is kept in step (records with the same value keep their order, so their entries stay in order)
+//returns false (leaving the list as it is) if the field has no ordered index built
+bool sortByOrderedIndex(RecordList& list, SortKey field, bool descending)
+{
+    OrderedIndex* index = orderedIndexFor(list, field);
+    if (index == nullptr || !index->built)
+    {
+        return false;
+    }
+    vector<OrderedEntry*> sorted;
+    sorted.reserve(list.size);
+    collectOrdered(*index, numeric_limits<long long>::min(), numeric_limits<long long>::max(), descending, sorted);
+
+#ifdef ARCADE_CONTIGUOUS_STORE
+    //the records themselves are moved into order; squeezing out the tombstones first moves every record after one
+    //down, so work out where each record will be before anything moves
+    RecordStore& store = list.store;
+    vector<size_t> source;
+    source.reserve(sorted.size());
+    for (const OrderedEntry* entry : sorted)
+    {
+        source.push_back(static_cast<size_t>(entry->node->order));
+    }
+
+    //moving records drops every index that points at them, so this one is set aside meanwhile, then pointed at the
+    //records' new positions
+    OrderedIndex saved{ move(*index) };
+    if (store.tombstones > 0)
+    {
+        vector<size_t> moved(store.used);
+        size_t kept{ 0 };
+        for (size_t position{ 0 }; position < store.used; ++position)
+        {
+            moved[position] = kept;
+            kept += store.live[position];
+        }
+        for (size_t& position : source)
+        {
+            position = moved[position];
+        }
+        compactRecords(list);
+    }
+    permuteRecords(list, source);
+    for (size_t position{ 0 }; position < sorted.size(); ++position)
+    {
+        sorted[position]->node = &recordAt(store, position);
+        sorted[position]->order = position;
+    }
+    *index = move(saved);
+#else
+    //relink the nodes in index order, renumbering their order stamps (and their entries') as we go
+    GameData* previous = nullptr;
+    list.nextOrder = 0;
+    for (OrderedEntry* entry : sorted)
+    {
+        GameData* node = entry->node;
+        node->prev = previous;
+        if (previous == nullptr)
+        {
+            list.head = node;
+        }
+        else
+        {
+            previous->next = node;
+        }
+        node->order = list.nextOrder;
+        entry->order = list.nextOrder++;
+        previous = node;
+    }
+    previous->next = nullptr;
+    list.tail = previous;
+#endif
+    return true;
+}
+
+//function to turn one line of the database file (without its newline) into a new, unlinked GameData node
+//lines look like "Name, HighScore, Initials, Plays, $Revenue"; fields are read in place, without copying the line
+GameData* parseDatabaseLine(RecordList& list, const char* begin, const char* end)
+{
+    //split line at its commas: name is everything before first comma, each other field runs to the next comma
+    //(a field missing from a short line is left empty)
+    string_view fields[5];
+    const char* fieldStart = begin;
+    for (int field{ 0 }; field < 5 && fieldStart <= end; ++field)
+    {
+        const char* comma = static_cast<const char*>(memchr(fieldStart, ',', static_cast<size_t>(end - fieldStart)));
+        const char* fieldEnd = (comma != nullptr) ? comma : end;
+        fields[field] = string_view(fieldStart, static_cast<size_t>(fieldEnd - fieldStart));
+        fieldStart = fieldEnd + 1;
+    }
+
+    //remove leading space from high score, initials and plays, and leading space and $ from revenue
+    string_view highScore{ fields[1].substr(fields[1].empty() ? 0 : 1) };
+    string_view initials{ fields[2].substr(fields[2].empty() ? 0 : 1) };
+    string_view plays{ fields[3].substr(fields[3].empty() ? 0 : 1) };
+    string_view revenue{ fields[4].substr(fields[4].size() < 2 ? fields[4].size() : 2) };
+
+    //create new GameData node with extracted data:
+    GameData* newGame = newRecord(list, fields[0]);
+
+    //store highScore and plays as numbers (leading zeroes are dropped, as they always were)
+    setHighScore(list, *newGame, cutLeadingZeroes(highScore));
+    setPlays(list, *newGame, cutLeadingZeroes(plays));
+    setInitials(list, *newGame, initials);
+
+    //store revenue in cents: plain amounts convert exactly, anything else is rounded to 2 decimal places like before
+    long long cents{ 0 };
+    if (exactCents(revenue, cents))
+    {
+        newGame->revenue = cents;
+    }
+    else
+    {
+        setRevenue(list, *newGame, parseDouble(revenue));
+    }
+    return newGame;
+}
+
+//function to parse every line between 'begin' and 'end' and append the records to the list
+void loadRecords(RecordList& list, const char* begin, const char* end)
+{
+    const char* lineStart = begin;
+    while (lineStart < end)
+    {
+        //find end of this line (the last line may not have a newline)
+        const char* newline = static_cast<const char*>(memchr(lineStart, '\n', static_cast<size_t>(end - lineStart)));
+        const char* lineEnd = (newline != nullptr) ? newline : end;
+
+        //blank lines hold no record, so they are skipped (a Windows line ending leaves a '\r' on a blank line)
+        const char* textEnd = (lineEnd > lineStart && lineEnd[-1] == '\r') ? lineEnd - 1 : lineEnd;
+        if (textEnd > lineStart)
+        {
+            //append new node to end of list (this also updates tail and name index)
+            appendNode(list, parseDatabaseLine(list, lineStart, lineEnd));
+        }
+        lineStart = lineEnd + 1;
+    }
+}
+
+//function to move every record of 'other' onto the end of 'list', leaving 'other' empty
+//the nodes and text stay where they are; 'list' just takes over the memory they live in
+void appendList(RecordList& list, RecordList& other)
+{
+    //take over other list's arena blocks (put in front, so our own last block keeps being filled)
+    list.arena.blocks.insert(list.arena.blocks.begin(), make_move_iterator(other.arena.blocks.begin()), make_move_iterator(other.arena.blocks.end()));
+
+#ifdef ARCADE_CONTIGUOUS_STORE
+    //records have to sit in list order, so other list's records are copied onto the end of our store
+    size_t firstPosition{ list.store.used };
+    for (GameData* node = firstRecord(other); node != nullptr; node = nextRecord(other, node))
+    {
+        GameData* copy = allocateRecord(list);
+        unsigned long long position{ copy->order };
+        *copy = *node;
+        copy->order = position;
+        list.store.live[position] = 1;
+        ++list.size;
+    }
+    GameData* firstNew = recordFrom(list.store, firstPosition);
+#else
+    //take over other list's slabs too
+    list.pool.slabs.insert(list.pool.slabs.begin(), make_move_iterator(other.pool.slabs.begin()), make_move_iterator(other.pool.slabs.end()));
+
+    //link other list's nodes on after our tail, continuing the order stamps from where ours left off
+    for (GameData* node = other.head; node != nullptr; node = node->next)
+    {
+        node->order = list.nextOrder++;
+    }
+    GameData* firstNew = other.head;
+    if (other.head != nullptr)
+    {
+        other.head->prev = list.tail;
+        if (list.tail == nullptr)
+        {
+            list.head = other.head;
+        }
+        else
+        {
+            list.tail->next = other.head;
+        }
+        list.tail = other.tail;
+        list.size += other.size;
+    }
+#endif
+
+    //names of the new nodes go into the index too, if it is already in use
+    if (list.nameIndex.built)
+    {
+        list.nameIndex.built = false;
+        list.nameIndex.slots.clear();
+        list.nameIndex.used = 0;
+        buildNameIndex(list);
+    }
+    if (list.searchIndex.built)
+    {
+        for (GameData* node = firstNew; node != nullptr; node = nextRecord(list, node))
+        {
+            addSearchNode(list.searchIndex, node);
+        }
+    }
+
+    //other list no longer owns anything
+#ifdef ARCADE_CONTIGUOUS_STORE
+    other.store = RecordStore{};
+#else
+    other.head = nullptr;
+    other.tail = nullptr;
+    other.pool = NodePool{};
+#endif
+    other.size = 0;
+    other.arena = StringArena{};
+}
+
+//function to parse the lines between 'begin' and 'end' on several threads at once
+//each thread parses its own chunk of whole lines into a list of its own; the lists are then joined in file order,
+//so the result is exactly what loadRecords would have produced
+void loadRecordsInParallel(RecordList& list, const char* begin, const char* end, unsigned int threads)
+{
+    size_t size{ static_cast<size_t>(end - begin) };
+
+    //split into chunks that start just after a newline (or at start of file), so no line is split
+    vector<const char*> bounds{ begin };
+    for (unsigned int chunk{ 1 }; chunk < threads; ++chunk)
+    {
+        const char* bound = begin + size / threads * chunk;
+        if (bound < bounds.back())
+        {
+            bound = bounds.back();
+        }
+        const char* newline = static_cast<const char*>(memchr(bound - 1, '\n', static_cast<size_t>(end - (bound - 1))));
+        bounds.push_back(newline != nullptr ? newline + 1 : end);
+    }
+    bounds.push_back(end);
+
+    //parse every chunk on its own thread, into a list of its own
+    vector<RecordList> chunkLists(threads);
+    vector<thread> workers;
+    for (unsigned int chunk{ 0 }; chunk < threads; ++chunk)
+    {
+#ifndef ARCADE_CONTIGUOUS_STORE
+        chunkLists[chunk].pool.useHeap = list.pool.useHeap;
+#endif
+        workers.emplace_back(loadRecords, ref(chunkLists[chunk]), bounds[chunk], bounds[chunk + 1]);
+    }
+    for (thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    //join chunk lists together, in file order
+    for (RecordList& chunkList : chunkLists)
+    {
+        appendList(list, chunkList);
+    }
+}
+
+//function to read data from database file and create linked list of GameData structures
+//the file is memory-mapped and parsed in place, on 'threads' threads (0 means one per core)
+//'format' is set to the format the file was in; returns false if the file cannot be read
+bool createLinkedList(RecordList& list, const string& filename, unsigned int threads, DatabaseFormat& format)
+{
+    MappedFile file;
+    if (!mapFile(filename, file))
+    {
+        return false;
+    }
+
+    //snapshots need no parsing: their records are copied straight into the list
+    format = isSnapshot(file) ? DatabaseFormat::Snapshot : DatabaseFormat::Text;
+    if (format == DatabaseFormat::Snapshot)
+    {
+        return loadSnapshot(list, file);
+    }
+
+    //use fewer threads for small files, so each one has at least 1MB to parse
+    if (threads == 0)
+    {
+        threads = thread::hardware_concurrency() > 0 ? thread::hardware_concurrency() : 1;
+    }
+    size_t usefulThreads{ file.size / (1 << 20) };
+    if (threads > usefulThreads)
+    {
+        threads = usefulThreads > 0 ? static_cast<unsigned int>(usefulThreads) : 1;
+    }
+
+    if (threads > 1)
+    {
+        loadRecordsInParallel(list, file.data, file.data + file.size, threads);
+    }
+    else
+    {
+        loadRecords(list, file.data, file.data + file.size);
+    }
+    return true;
+}
+
+//function to work out a snapshot's checksum (of everything after its header)
+//reads 8 bytes at a time into four independent running hashes, so checking a large snapshot takes little time
+uint64_t snapshotChecksum(const char* data, size_t size)
+{
+    const uint64_t multiplier{ 0x9E3779B97F4A7C15ULL };
+    uint64_t lanes[4]{ 1, 2, 3, 4 };
+    size_t position{ 0 };
+    for (; position + 32 <= size; position += 32)
+    {
+        for (int lane{ 0 }; lane < 4; ++lane)
+        {
+            uint64_t word;
+            memcpy(&word, data + position + lane * 8, sizeof(word));
+            lanes[lane] = (lanes[lane] ^ word) * multiplier;
+            lanes[lane] ^= lanes[lane] >> 29;
+        }
+    }
+    for (; position < size; ++position)
+    {
+        lanes[0] = (lanes[0] ^ static_cast<unsigned char>(data[position])) * multiplier;
+    }
+
+    uint64_t checksum{ size };
+    for (uint64_t lane : lanes)
+    {
+        checksum = (checksum ^ lane) * multiplier;
+        checksum ^= checksum >> 32;
+    }
+    return checksum;
+}
+
+//function to check whether a database file is a snapshot (rather than text)
+//only the magic decides: a snapshot cut short of its header is still a snapshot, which loadSnapshot refuses as truncated
+bool isSnapshot(const MappedFile& file)
+{
+    return file.size >= 8 && memcmp(file.data, "ARCADEDB", 8) == 0;
+}
+
+//function to get the text a snapshot string refers to (the heap has already been copied into the arena)
+//clears 'valid' if the string does not lie inside the heap
+TextRef snapshotText(const SnapshotString& string, const char* heap, uint64_t heapSize, bool& valid)
+{
+    if (string.offset == snapshotNoText)
+    {
+        return TextRef{};
+    }
+    if (string.offset > heapSize || string.size > heapSize - string.offset)
+    {
+        valid = false;
+        return TextRef{};
+    }
+    return TextRef{ heap + string.offset, string.size };
+}
+
+//function to fill the list from a snapshot: records are fixed width and numbers are stored as numbers,
+//so nothing is parsed; the whole string heap is copied into the arena in one go and names point into it
+//returns false (with an explanation on cerr) if the snapshot is damaged or from an unsupported version
+bool loadSnapshot(RecordList& list, const MappedFile& file)
+{
+    if (file.size < sizeof(SnapshotHeader))
+    {
+        cerr << "datafile snapshot is truncated or damaged.\n";
+        return false;
+    }
+    SnapshotHeader header;
+    memcpy(&header, file.data, sizeof(header));
+    if (header.byteOrder != 0x01020304 || header.recordSize != sizeof(SnapshotRecord) || header.textSize != sizeof(SnapshotText))
+    {
+        cerr << "datafile snapshot was written by an incompatible machine or program.\n";
+        return false;
+    }
+    if (header.version != snapshotVersion)
+    {
+        cerr << "datafile snapshot has unsupported version " << header.version << ".\n";
+        return false;
+    }
+
+    //sections must fill the rest of the file exactly, and match the checksum
+    const uint64_t available{ file.size - sizeof(SnapshotHeader) };
+    if (header.recordCount > available / sizeof(SnapshotRecord)
+        || header.textCount > (available - header.recordCount * sizeof(SnapshotRecord)) / sizeof(SnapshotText)
+        || header.heapSize != available - header.recordCount * sizeof(SnapshotRecord) - header.textCount * sizeof(SnapshotText))
+    {
+        cerr << "datafile snapshot is truncated or damaged.\n";
+        return false;
+    }
+    const char* body = file.data + sizeof(SnapshotHeader);
+    if (snapshotChecksum(body, static_cast<size_t>(available)) != header.checksum)
+    {
+        cerr << "datafile snapshot is damaged (checksum does not match).\n";
+        return false;
+    }
+
+    //copy heap into the arena, so the records' text outlives the mapping of the file
+    const char* records = body;
+    const char* texts = records + header.recordCount * sizeof(SnapshotRecord);
+    const char* fileHeap = texts + header.textCount * sizeof(SnapshotText);
+    char* heap = static_cast<char*>(allocateFromArena(list.arena, static_cast<size_t>(header.heapSize), 1));
+    if (header.heapSize > 0)
+    {
+        memcpy(heap, fileHeap, static_cast<size_t>(header.heapSize));
+    }
+
+    bool valid{ true };
+    for (uint64_t i{ 0 }; i < header.recordCount && valid; ++i)
+    {
+        SnapshotRecord record;
+        memcpy(&record, records + i * sizeof(SnapshotRecord), sizeof(record));
+
+        GameData* node = allocateRecord(list);
+        node->name = snapshotText(record.name, heap, header.heapSize, valid);
+        node->highScore = record.highScore;
+        node->plays = record.plays;
+        node->revenue = record.revenue;
+        memcpy(node->initials, record.initials, sizeof(node->initials));
+        node->initials[sizeof(node->initials) - 1] = '\0';
+
+        //the few records whose fields don't print the same as their numbers get their RecordText back
+        if (record.text != snapshotNoText)
+        {
+            if (record.text >= header.textCount)
+            {
+                valid = false;
+            }
+            else
+            {
+                SnapshotText text;
+                memcpy(&text, texts + record.text * sizeof(SnapshotText), sizeof(text));
+                RecordText& nodeText = recordText(list, *node);
+                nodeText.highScore = snapshotText(text.highScore, heap, header.heapSize, valid);
+                nodeText.plays = snapshotText(text.plays, heap, header.heapSize, valid);
+                nodeText.revenue = snapshotText(text.revenue, heap, header.heapSize, valid);
+                nodeText.initials = snapshotText(text.initials, heap, header.heapSize, valid);
+            }
+        }
+        appendNode(list, node);
+    }
+    if (!valid)
+    {
+        cerr << "datafile snapshot is damaged (text outside of string heap).\n";
+        freeAllRecords(list);
+        return false;
+    }
+    return true;
+}
+
+//function to send reports to a file instead of the console
+//returns false if the file cannot be opened
+bool openReportFile(ReportSink& report, const string& filename)
+{
+    report.file.open(filename, ios::out | ios::binary | ios::trunc);
+    if (!report.file)
+    {
+        return false;
+    }
+    report.stream = &report.file;
+    return true;
+}
+
+//function to write out all buffered report text
+void flushReport(ReportSink& report)
+{
+    report.stream->write(report.buffer.data(), static_cast<streamsize>(report.buffer.size()));
+    report.stream->flush();
+    report.buffer.clear();
+}
+
+//functions to add text to a report (nothing is kept in quiet mode)
+//the buffer is written out once it fills up, so reports reach their destination in large blocks
+ReportSink& operator<<(ReportSink& report, string_view text)
+{
+    if (!report.quiet)
+    {
+        report.buffer.append(text);
+        if (report.buffer.size() >= report.flushSize && !report.hold)
+        {
+            flushReport(report);
+        }
+    }
+    return report;
+}
+
+ReportSink& operator<<(ReportSink& report, char character)
+{
+    return report << string_view(&character, 1);
+}
+
+ReportSink& operator<<(ReportSink& report, const FieldText& field)
+{
+    return report << field.view();
+}
+
+//function to print the counts of a quiet run (always printed, even though the report is quiet)
+void printReportSummary(ReportSink& report)
+{
+    const ReportCounts& counts = report.counts;
+    string summary;
+    summary += "BATCH SUMMARY\n";
+    summary += "Records added: " + to_string(counts.added) + '\n';
+    summary += "Searches: " + to_string(counts.searches) + " (" + to_string(counts.searchMatches) + " records found, "
+        + to_string(counts.searchesNotFound) + " not found)\n";
+    summary += "Records edited: " + to_string(counts.edited) + " (" + to_string(counts.editsNotFound) + " not found)\n";
+    summary += "Records deleted: " + to_string(counts.deleted) + " (" + to_string(counts.deletesNotFound) + " not found)\n";
+    summary += "Sorts: " + to_string(counts.sorts) + '\n';
+    summary += "Aggregates: " + to_string(counts.aggregates) + '\n';
+    summary += "Reprices: " + to_string(counts.reprices) + " (" + to_string(counts.repricedRecords) + " records changed, "
+        + to_string(counts.repricesNotFound) + " not found)\n";
+    summary += "Ranges: " + to_string(counts.ranges) + " (" + to_string(counts.rangeRecords) + " records listed)\n";
+    report.buffer.append(summary);
+}
+
+//function to split one line of the batch file into a command
+//returns false (with a description in 'error') if the line is not a valid command
+bool parseCommand(string_view line, BatchCommand& command, string& error)
+{
+    //first character says which command this is
+    if (line.empty() || line[0] < '1' || line[0] > '8')
+    {
+        error = "unknown command";
+        return false;
+    }
+    command.type = static_cast<CommandType>(line[0] - '0');
+    command.line = line;
+
+    //search, delete, sort, aggregate and range take the rest of the line after "N " as their argument
+    if (command.type == CommandType::Search || command.type == CommandType::Delete || command.type == CommandType::Sort
+        || command.type == CommandType::Aggregate || command.type == CommandType::Range)
+    {
+        if (line.size() < 2)
+        {
+            error = "missing argument";
+            return false;
+        }
+        command.name = line.substr(2);
+        if (command.type == CommandType::Sort)
+        {
+            parseSortMethod(command.name, command.sortMethod);
+        }
+        if (command.type == CommandType::Aggregate && !parseAggregateQuery(command.name, command.aggregate))
+        {
+            error = "expected: 6 <function> plays|highscore|revenue [N|P]";
+            return false;
+        }
+        if (command.type == CommandType::Range && !parseRangeQuery(command.name, command.range))
+        {
+            error = "expected: 8 plays|highscore|revenue [Low|* High|*] [desc]";
+            return false;
+        }
+        return true;
+    }
+
+    //reprice takes the price per play (with or without a $), after the game name in double quotes if only one game
+    //is repriced; the price must be a whole number of cents
+    if (command.type == CommandType::Reprice)
+    {
+        string_view price{ line.size() < 2 ? string_view() : line.substr(2) };
+        if (!price.empty() && price[0] == '\"')
+        {
+            size_t closingQuote{ price.find('\"', 1) };
+            if (closingQuote == string_view::npos || closingQuote == 1 || closingQuote + 1 >= price.size() || price[closingQuote + 1] != ' ')
+            {
+                error = "expected: 7 \"Name\" PricePerPlay";
+                return false;
+            }
+            command.name = price.substr(1, closingQuote - 1);
+            price = price.substr(closingQuote + 2);
+        }
+        if (!price.empty() && price[0] == '$')
+        {
+            price.remove_prefix(1);
+        }
+        if (price.empty() || !isdigit(static_cast<unsigned char>(price.back())) || !exactCents(price, command.price))
+        {
+            error = "expected: 7 [\"Name\"] PricePerPlay (in dollars, with at most 2 decimals)";
+            return false;
+        }
+        return true;
+    }
+
+    //add and edit start with the game name in double quotes
+    size_t doubleQuote1{ line.find('\"') };
+    size_t doubleQuote2{ doubleQuote1 == string_view::npos ? string_view::npos : line.find('\"', doubleQuote1 + 1) };
+    if (doubleQuote2 == string_view::npos)
+    {
+        error = "game name must be in double quotes";
+        return false;
+    }
+    command.name = line.substr(doubleQuote1 + 1, doubleQuote2 - (doubleQuote1 + 1));
+
+    //fields after the name are separated by single spaces (searching starts at the closing quote,
+    //because the name itself can contain spaces)
+    size_t spaces[4];
+    size_t spaceCount{ command.type == CommandType::Add ? 4u : 2u };
+    size_t searchFrom{ doubleQuote2 };
+    for (size_t i{ 0 }; i < spaceCount; ++i)
+    {
+        spaces[i] = line.find(' ', searchFrom);
+        if (spaces[i] == string_view::npos)
+        {
+            error = command.type == CommandType::Add ? "expected: 1 \"Name\" HighScore Initials Plays $Revenue"
+                                                     : "expected: 3 \"Name\" FieldNumber NewValue";
+            return false;
+        }
+        searchFrom = spaces[i] + 1;
+    }
+
+    if (command.type == CommandType::Add)
+    {
+        //revenue starts one character after the last space (skipping the $)
+        if (spaces[3] + 2 > line.size())
+        {
+            error = "missing revenue";
+            return false;
+        }
+        command.value = line.substr(spaces[0] + 1, spaces[1] - (spaces[0] + 1));
+        command.initials = line.substr(spaces[1] + 1, spaces[2] - (spaces[1] + 1));
+        command.plays = line.substr(spaces[2] + 1, spaces[3] - (spaces[2] + 1));
+        command.revenue = line.substr(spaces[3] + 2);
+    }
+    else
+    {
+        //field number is the single character after the first space; new value is everything after the second
+        command.field = spaces[0] + 1 < line.size() ? line[spaces[0] + 1] : '\0';
+        command.value = line.substr(spaces[1] + 1);
+    }
+    return true;
+}
+
+//function to read the batch file and parse all of its lines into commands
+//invalid lines are reported on cerr with their line numbers and left out; returns false if the file can't be read
+bool loadBatch(const string& filename, Batch& batch)
+{
+    if (!mapFile(filename, batch.file))
+    {
+        return false;
+    }
+    parseBatch(batch, cerr);
+    return true;
+}
+
+//function to parse every line of a batch's file contents into commands, reporting invalid lines on 'errors'
+void parseBatch(Batch& batch, ostream& errors)
+{
+    const char* lineStart = batch.file.data;
+    const char* end = batch.file.data + batch.file.size;
+    unsigned int lineNumber{ 0 };
+    string error;
+    while (lineStart < end)
+    {
+        //find end of this line (the last line may not have a newline)
+        const char* newline = static_cast<const char*>(memchr(lineStart, '\n', static_cast<size_t>(end - lineStart)));
+        const char* lineEnd = (newline != nullptr) ? newline : end;
+        string_view line(lineStart, static_cast<size_t>(lineEnd - lineStart));
+        lineStart = lineEnd + 1;
+        ++lineNumber;
+#ifdef _WIN32
+        //batch files used to be read in text mode, which drops the '\r' of Windows line endings
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.remove_suffix(1);
+        }
+#endif
+
+        //blank lines are allowed, and ignored
+        if (line.empty())
+        {
+            continue;
+        }
+
+        BatchCommand command;
+        command.lineNumber = lineNumber;
+        if (parseCommand(line, command, error))
+        {
+            //unknown sort methods still run (and list the records unsorted), but are worth pointing out
+            if (command.type == CommandType::Sort && !command.sortMethod.known)
+            {
+                errors << "batchfile line " << lineNumber << ": unknown sort method \"" << command.name << "\"\n";
+            }
+            batch.commands.push_back(command);
+        }
+        else
+        {
+            errors << "batchfile line " << lineNumber << ": " << error << ": " << line << '\n';
+            ++batch.errorCount;
+        }
+    }
+}
+
+//functions that run one kind of batch command, all with the same signature so they fit in the dispatch table
+void runAddCommand(RecordList& list, ReportSink& report, const BatchCommand& command)
+{
+    addRecord(list, report, command.name, command.value, command.initials, command.plays, command.revenue);
+}
+
+void runSearchCommand(RecordList& list, ReportSink& report, const BatchCommand& command)
+{
+    searchRecord(list, report, command.name);
+}
+
+void runEditCommand(RecordList& list, ReportSink& report, const BatchCommand& command)
+{
+    editRecord(list, report, command.name, command.field, command.value);
+}
+
+void runDeleteCommand(RecordList& list, ReportSink& report, const BatchCommand& command)
+{
+    deleteRecord(list, report, command.name);
+}
+
+void runSortCommand(RecordList& list, ReportSink& report, const BatchCommand& command)
+{
+    sortRecords(list, report, command.sortMethod);
+}
+
+void runAggregateCommand(RecordList& list, ReportSink& report, const BatchCommand& command)
+{
+    aggregateRecords(list, report, command.aggregate);
+}
+
+void runRepriceCommand(RecordList& list, ReportSink& report, const BatchCommand& command)
+{
+    repriceRecords(list, report, command.name, command.price);
+}
+
+void runRangeCommand(RecordList& list, ReportSink& report, const BatchCommand& command)
+{
+    listRange(list, report, command.range);
+}
+
+//function to check whether a kind of command can change the records (and so has to be journaled)
+bool changesRecords(CommandType type)
+{
+    return type != CommandType::Search && type != CommandType::Aggregate && type != CommandType::Range;
+}
+
+//dispatch table: function that runs each command type, indexed by the command's number
+using CommandHandler = void (*)(RecordList& list, ReportSink& report, const BatchCommand& command);
+const CommandHandler commandHandlers[] =
+{
+    nullptr,              //0: not a command
+    runAddCommand,        //1: add record
+    runSearchCommand,     //2: search records
+    runEditCommand,       //3: edit record
+    runDeleteCommand,     //4: delete record
+    runSortCommand,       //5: sort records
+    runAggregateCommand,  //6: aggregate over a numeric field
+    runRepriceCommand,    //7: recompute revenue from a price per play
+    runRangeCommand       //8: list records in a range of a numeric field
+};
+
+//name of each command type, for reports that list the commands by kind
+const char* const commandNames[] = { "", "add", "search", "edit", "delete", "sort", "aggregate", "reprice", "range" };
+
+//function to add to the count of records commands have looked at (compiled away when built with ARCADE_NO_STATS)
+void countVisited(RecordList& list, size_t nodes)
+{
+#ifndef ARCADE_NO_STATS
+    list.nodesVisited += nodes;
+#else
+    (void)list;
+    (void)nodes;
+#endif
+}
+
+//function to get the number of nanoseconds since 'start'
+unsigned long long nanosecondsSince(chrono::steady_clock::time_point start)
+{
+    return static_cast<unsigned long long>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+}
+
+//function to get the latency histogram bucket a time falls in
+//times under 4ns have a bucket each; after that each power of two is split into four equally wide buckets
+size_t latencyBucket(unsigned long long nanoseconds)
+{
+    if (nanoseconds < 4)
+    {
+        return static_cast<size_t>(nanoseconds);
+    }
+#if defined(__GNUC__)
+    size_t power{ 63 - static_cast<size_t>(__builtin_clzll(nanoseconds)) };
+#else
+    size_t power{ 2 };
+    while (power < 63 && (nanoseconds >> (power + 1)) != 0)
+    {
+        ++power;
+    }
+#endif
+    return (power - 1) * 4 + static_cast<size_t>((nanoseconds >> (power - 2)) & 3);
+}
+
+//function to get the longest time (in nanoseconds) that falls in a latency histogram bucket
+unsigned long long bucketLimit(size_t bucket)
+{
+    if (bucket < 4)
+    {
+        return bucket;
+    }
+    size_t power{ bucket / 4 + 1 };
+    unsigned long long quarter{ 1ULL << (power - 2) };
+    return (4 + bucket % 4 + 1) * quarter - 1;
+}
+
+//function to add one run of a command to the stats of its command type
+void recordCommand(RunStats& stats, CommandType type, unsigned long long nanoseconds, size_t nodes)
+{
+    CommandStats& command = stats.commands[static_cast<size_t>(type)];
+    ++command.count;
+    command.nodesVisited += nodes;
+    command.totalNanoseconds += nanoseconds;
+    command.maxNanoseconds = max(command.maxNanoseconds, nanoseconds);
+    ++command.latencyBuckets[latencyBucket(nanoseconds)];
+}
+
+//function to get the time a fraction (0 to 1) of a command type's runs took at most (nearest rank), to within the
+//width of its histogram bucket; never more than the slowest run
+unsigned long long latencyAtFraction(const CommandStats& command, double fraction)
+{
+    size_t rank{ max(static_cast<size_t>(ceil(fraction * static_cast<double>(command.count))), size_t{ 1 }) };
+    size_t seen{ 0 };
+    for (size_t bucket{ 0 }; bucket < CommandStats::bucketCount; ++bucket)
+    {
+        seen += command.latencyBuckets[bucket];
+        if (seen >= rank)
+        {
+            return min(bucketLimit(bucket), command.maxNanoseconds);
+        }
+    }
+    return command.maxNanoseconds;
+}
+
+//function to write a run's stats as a JSON object: load and write timings, then for each command type that ran,
+//its count, outcomes (hits and misses where a command can miss), records looked at, latencies and latency histogram
+//(each bucket as [longest time in bucket, number of commands], in nanoseconds; empty buckets are left out)
+void writeStats(ostream& out, const RunStats& stats, const ReportCounts& counts)
+{
+    string json;
+    json += "{\n  \"records_loaded\": " + to_string(stats.loadedRecords)
+        + ",\n  \"load_ns\": " + to_string(stats.loadNanoseconds)
+        + ",\n  \"records_written\": " + to_string(stats.writtenRecords)
+        + ",\n  \"write_ns\": " + to_string(stats.writeNanoseconds)
+        + ",\n  \"commands\": {";
+
+    bool firstCommand{ true };
+    for (size_t type{ 1 }; type < sizeof(stats.commands) / sizeof(stats.commands[0]); ++type)
+    {
+        const CommandStats& command = stats.commands[type];
+        if (command.count == 0)
+        {
+            continue;
+        }
+        json += firstCommand ? "\n" : ",\n";
+        firstCommand = false;
+        json += string("    \"") + commandNames[type] + "\": {\"count\": " + to_string(command.count);
+
+        //what the commands found, from the counts every report keeps
+        switch (static_cast<CommandType>(type))
+        {
+        case CommandType::Search:
+            json += ", \"hits\": " + to_string(counts.searches - counts.searchesNotFound) + ", \"misses\": " + to_string(counts.searchesNotFound)
+                + ", \"records_found\": " + to_string(counts.searchMatches);
+            break;
+        case CommandType::Edit:
+            json += ", \"hits\": " + to_string(counts.edited) + ", \"misses\": " + to_string(counts.editsNotFound);
+            break;
+        case CommandType::Delete:
+            json += ", \"hits\": " + to_string(counts.deleted) + ", \"misses\": " + to_string(counts.deletesNotFound);
+            break;
+        case CommandType::Reprice:
+            json += ", \"hits\": " + to_string(counts.reprices) + ", \"misses\": " + to_string(counts.repricesNotFound)
+                + ", \"records_changed\": " + to_string(counts.repricedRecords);
+            break;
+        case CommandType::Range:
+            json += ", \"records_listed\": " + to_string(counts.rangeRecords);
+            break;
+        default:
+            break;
+        }
+
+        json += ", \"nodes_visited\": " + to_string(command.nodesVisited)
+            + ", \"total_ns\": " + to_string(command.totalNanoseconds)
+            + ", \"p50_ns\": " + to_string(latencyAtFraction(command, 0.5))
+            + ", \"p90_ns\": " + to_string(latencyAtFraction(command, 0.9))
+            + ", \"p99_ns\": " + to_string(latencyAtFraction(command, 0.99))
+            + ", \"max_ns\": " + to_string(command.maxNanoseconds)
+            + ", \"histogram_ns\": [";
+        bool firstBucket{ true };
+        for (size_t bucket{ 0 }; bucket < CommandStats::bucketCount; ++bucket)
+        {
+            if (command.latencyBuckets[bucket] == 0)
+            {
+                continue;
+            }
+            json += firstBucket ? "[" : ", [";
+            firstBucket = false;
+            json += to_string(bucketLimit(bucket)) + ", " + to_string(command.latencyBuckets[bucket]) + ']';
+        }
+        json += "]}";
+    }
+    json += firstCommand ? "}\n}\n" : "\n  }\n}\n";
+    out << json << flush;
+}
+
+//function to print a run's stats as JSON, to the error output (so they never mix with the reports) or to the stats file
+void reportStats(const ProgramOptions& options, const RunStats& stats, const ReportCounts& counts)
+{
+    if (options.statsFile.empty())
+    {
+        writeStats(cerr, stats, counts);
+        return;
+    }
+    ofstream statsFile(options.statsFile, ios::out | ios::binary | ios::trunc);
+    writeStats(statsFile, stats, counts);
+    if (!statsFile)
+    {
+        cerr << "stats file could not be written.\n";
+    }
+}
+
+//function to add the outcomes of one batch's commands to a running total
+void addCounts(ReportCounts& total, const ReportCounts& counts)
+{
+    total.added += counts.added;
+    total.searches += counts.searches;
+    total.searchMatches += counts.searchMatches;
+    total.searchesNotFound += counts.searchesNotFound;
+    total.edited += counts.edited;
+    total.editsNotFound += counts.editsNotFound;
+    total.deleted += counts.deleted;
+    total.deletesNotFound += counts.deletesNotFound;
+    total.sorts += counts.sorts;
+    total.aggregates += counts.aggregates;
+    total.reprices += counts.reprices;
+    total.repricedRecords += counts.repricedRecords;
+    total.repricesNotFound += counts.repricesNotFound;
+    total.ranges += counts.ranges;
+    total.rangeRecords += counts.rangeRecords;
+}
+
+//function to run every command of a parsed batch against the list, in order
+//commands that change the database are written to the journal (if there is one) before they run
+//with reader threads, searches are answered by them (from the records as they are at that point of the batch) while
+//this thread carries on with the commands after them; reports still come out in batch order
+//with stats enabled, each command is timed and the records it looks at are counted (searches answered by reader
+//threads are timed by the reader, from when it starts on the search)
+void runBatch(RecordList& list, ReportSink& report, Journal& journal, const Batch& batch, unsigned int readerThreads, RunStats& stats)
+{
+    unique_ptr<SharedRecords> shared;
+    unique_ptr<SearchReaders> readers;
+    if (readerThreads > 0)
+    {
+        shared.reset(new SharedRecords);
+        list.shared = shared.get();
+        publishAll(*shared, list);
+
+        size_t searches{ 0 };
+        for (const BatchCommand& command : batch.commands)
+        {
+            searches += command.type == CommandType::Search ? 1 : 0;
+        }
+        readers.reset(new SearchReaders);
+        readers->jobs.reset(new SearchJob[searches]);
+        readers->segments.resize(searches);
+        for (unsigned int i{ 0 }; i < readerThreads; ++i)
+        {
+            readers->threads.emplace_back(answerSearches, ref(*readers));
+        }
+    }
+
+    for (const BatchCommand& command : batch.commands)
+    {
+        if (journal.enabled && changesRecords(command.type))
+        {
+            journalCommand(journal, command.line);
+        }
+        if (readers != nullptr && command.type == CommandType::Search)
+        {
+            queueSearch(*readers, *shared, report, command.name);
+        }
+        else
+        {
+            chrono::steady_clock::time_point start{ stats.enabled ? chrono::steady_clock::now() : chrono::steady_clock::time_point() };
+            unsigned long long visited{ list.nodesVisited };
+            commandHandlers[static_cast<size_t>(command.type)](list, report, command);
+            if (stats.enabled)
+            {
+                recordCommand(stats, command.type, nanosecondsSince(start), static_cast<size_t>(list.nodesVisited - visited));
+            }
+            if (shared != nullptr)
+            {
+                publishChanges(*shared, list);
+            }
+        }
+        if (readers != nullptr)
+        {
+            drainSearches(*readers, *shared, report, false);
+        }
+    }
+
+    //wait for the last searches, print their reports, and stop sharing the records
+    if (readers != nullptr)
+    {
+        readers->finished.store(true);
+        for (thread& reader : readers->threads)
+        {
+            reader.join();
+        }
+        drainSearches(*readers, *shared, report, true);
+        freeSharedRecords(*shared);
+        list.shared = nullptr;
+        for (size_t i{ 0 }; stats.enabled && i < readers->ready.load(); ++i)
+        {
+            recordCommand(stats, CommandType::Search, readers->jobs[i].nanoseconds, readers->jobs[i].nodesVisited);
+        }
+    }
+}
+
+//function to make the immutable copy of a record that concurrent readers see
+const ReadRecord* copyForReaders(const GameData& node)
+{
+    ReadRecord* record = new ReadRecord{ node, RecordText{} };
+#ifndef ARCADE_CONTIGUOUS_STORE
+    record->data.next = nullptr;
+    record->data.prev = nullptr;
+#endif
+    record->data.nextSameName = nullptr;
+    if (node.text != nullptr)
+    {
+        record->text = *node.text;
+        record->data.text = &record->text;
+    }
+    return record;
+}
+
+//function to find the chunk and position of the record with an order stamp in a view (chunks are in order stamp order)
+//returns false if no record in the view has that stamp
+bool findInView(const ReadView& view, unsigned long long order, size_t& chunkIndex, size_t& position)
+{
+    auto chunk = lower_bound(view.chunks.begin(), view.chunks.end(), order,
+        [](const ReadChunk* chunk, unsigned long long order) { return chunk->records.back()->data.order < order; });
+    if (chunk == view.chunks.end())
+    {
+        return false;
+    }
+    const vector<const ReadRecord*>& records = (*chunk)->records;
+    auto record = lower_bound(records.begin(), records.end(), order,
+        [](const ReadRecord* record, unsigned long long order) { return record->data.order < order; });
+    if (record == records.end() || (*record)->data.order != order)
+    {
+        return false;
+    }
+    chunkIndex = static_cast<size_t>(chunk - view.chunks.begin());
+    position = static_cast<size_t>(record - records.begin());
+    return true;
+}
+
+//function to free whatever retired objects no reader can still be using: a reader (or queued search) that started
+//in epoch e can only hold objects that were still published in e, so objects retired in an epoch <= e must be kept
+void reclaimRetired(SharedRecords& shared)
+{
+    uint64_t oldest{ shared.pinnedEpoch };
+    for (const ReaderSlot& slot : shared.readers)
+    {
+        uint64_t epoch{ slot.epoch.load() };
+        if (epoch != 0 && (oldest == 0 || epoch < oldest))
+        {
+            oldest = epoch;
+        }
+    }
+
+    size_t kept{ 0 };
+    for (RetiredObjects& retired : shared.retired)
+    {
+        if (oldest != 0 && retired.epoch > oldest)
+        {
+            if (&shared.retired[kept] != &retired)
+            {
+                shared.retired[kept] = move(retired);
+            }
+            ++kept;
+            continue;
+        }
+        delete retired.view;
+        for (const ReadChunk* chunk : retired.chunks)
+        {
+            delete chunk;
+        }
+        for (const ReadRecord* record : retired.records)
+        {
+            delete record;
+        }
+    }
+    shared.retired.resize(kept);
+}
+
+//function to make a new view the one readers see; 'replaced' holds everything the old view used that the new one doesn't
+void publishView(SharedRecords& shared, const ReadView* view, RetiredObjects replaced)
+{
+    replaced.view = shared.current.exchange(view);
+    replaced.epoch = shared.epoch.fetch_add(1) + 1;
+    shared.retired.push_back(move(replaced));
+    shared.pending.clear();
+    shared.rebuild = false;
+    reclaimRetired(shared);
+}
+
+//function to publish a view made from scratch from every record of the list (used at the start, and after sorting,
+//which gives every record a new order stamp)
+void publishAll(SharedRecords& shared, const RecordList& list)
+{
+    ReadView* view = new ReadView;
+    const ReadView* old = shared.current.load();
+    view->version = (old != nullptr) ? old->version + 1 : 0;
+    view->size = list.size;
+    ReadChunk* chunk = nullptr;
+    for (GameData* node = firstRecord(list); node != nullptr; node = nextRecord(list, node))
+    {
+        if (chunk == nullptr || chunk->records.size() == SharedRecords::chunkSize)
+        {
+            chunk = new ReadChunk;
+            chunk->records.reserve(SharedRecords::chunkSize);
+            view->chunks.push_back(chunk);
+        }
+        chunk->records.push_back(copyForReaders(*node));
+        view->playsTotal += node->plays;
+    }
+
+    RetiredObjects replaced;
+    if (old != nullptr)
+    {
+        for (const ReadChunk* oldChunk : old->chunks)
+        {
+            replaced.chunks.push_back(oldChunk);
+            replaced.records.insert(replaced.records.end(), oldChunk->records.begin(), oldChunk->records.end());
+        }
+    }
+    publishView(shared, view, move(replaced));
+}
+
+//function to publish the writer's changes since the last publish: the new view shares every chunk and record that
+//did not change with the old one, so publishing a change costs time in proportion to the number of chunks, not records
+void publishChanges(SharedRecords& shared, const RecordList& list)
+{
+    if (shared.rebuild)
+    {
+        publishAll(shared, list);
+        return;
+    }
+    if (shared.pending.empty())
+    {
+        return;
+    }
+
+    const ReadView* old = shared.current.load();
+    ReadView* view = new ReadView(*old);
+    ++view->version;
+    RetiredObjects replaced;
+
+    //replace a chunk of the new view with a modified copy of it
+    auto copyChunk = [&view, &replaced](size_t chunkIndex)
+    {
+        ReadChunk* copy = new ReadChunk(*view->chunks[chunkIndex]);
+        replaced.chunks.push_back(view->chunks[chunkIndex]);
+        view->chunks[chunkIndex] = copy;
+        return copy;
+    };
+
+    for (const PendingChange& change : shared.pending)
+    {
+        size_t chunkIndex{ 0 };
+        size_t position{ 0 };
+        if (change.kind == PendingChange::Added)
+        {
+            //new records always have the largest order stamp, so they go at the end
+            const ReadRecord* record = copyForReaders(*change.node);
+            if (view->chunks.empty() || view->chunks.back()->records.size() == SharedRecords::chunkSize)
+            {
+                ReadChunk* chunk = new ReadChunk;
+                chunk->records.push_back(record);
+                view->chunks.push_back(chunk);
+            }
+            else
+            {
+                copyChunk(view->chunks.size() - 1)->records.push_back(record);
+            }
+            ++view->size;
+            view->playsTotal += record->data.plays;
+        }
+        else if (findInView(*view, change.kind == PendingChange::Edited ? change.node->order : change.order, chunkIndex, position))
+        {
+            ReadChunk* chunk = copyChunk(chunkIndex);
+            const ReadRecord* oldRecord = chunk->records[position];
+            replaced.records.push_back(oldRecord);
+            view->playsTotal -= oldRecord->data.plays;
+            if (change.kind == PendingChange::Edited)
+            {
+                chunk->records[position] = copyForReaders(*change.node);
+                view->playsTotal += change.node->plays;
+            }
+            else
+            {
+                chunk->records.erase(chunk->records.begin() + static_cast<ptrdiff_t>(position));
+                --view->size;
+                if (chunk->records.empty())
+                {
+                    replaced.chunks.push_back(chunk);
+                    view->chunks.erase(view->chunks.begin() + static_cast<ptrdiff_t>(chunkIndex));
+                }
+            }
+        }
+    }
+    publishView(shared, view, move(replaced));
+}
+
+//function to free everything shared with readers (once no reader thread is left)
+void freeSharedRecords(SharedRecords& shared)
+{
+    RetiredObjects last;
+    if (const ReadView* view = shared.current.load())
+    {
+        for (const ReadChunk* chunk : view->chunks)
+        {
+            last.chunks.push_back(chunk);
+            last.records.insert(last.records.end(), chunk->records.begin(), chunk->records.end());
+        }
+    }
+    publishView(shared, nullptr, move(last));
+    shared.pinnedEpoch = 0;
+    reclaimRetired(shared);
+}
+
+//function for a reader thread to start reading: announces the epoch it reads in (in its own slot), then gets the
+//current view, which stays valid until endRead; no lock is taken, and the writer never waits for readers
+const ReadView* beginRead(SharedRecords& shared, size_t slot)
+{
+    shared.readers[slot].epoch.store(shared.epoch.load());
+    return shared.current.load();
+}
+
+//function for a reader thread to finish reading (the view it had may be freed from now on)
+void endRead(SharedRecords& shared, size_t slot)
+{
+    shared.readers[slot].epoch.store(0);
+}
+
+//function to search a published view, reporting exactly what searchRecord would have for the list it was made from
+//returns the number of records looked at
+size_t searchView(ReportSink& report, const ReadView& view, string_view searchTerm)
+{
+    ++report.counts.searches;
+    string lowercaseTerm;
+    toLowercase(searchTerm, lowercaseTerm);
+    bool searchTermFound{ false };
+    for (const ReadChunk* chunk : view.chunks)
+    {
+        for (const ReadRecord* record : chunk->records)
+        {
+            if (containsIgnoreCase(record->data.name.view(), lowercaseTerm))
+            {
+                searchTermFound = true;
+                reportFoundRecord(report, record->data);
+            }
+        }
+    }
+    if (!searchTermFound)
+    {
+        ++report.counts.searchesNotFound;
+        report << searchTerm << " NOT FOUND\n";
+    }
+    return view.size;
+}
+
+//function run by each reader thread of a batch: answers queued searches until the batch is finished
+void answerSearches(SearchReaders& readers)
+{
+    for (;;)
+    {
+        size_t next{ readers.next.fetch_add(1) };
+        while (next >= readers.ready.load())
+        {
+            if (readers.finished.load() && next >= readers.ready.load())
+            {
+                return;
+            }
+            this_thread::yield();
+        }
+        SearchJob& job = readers.jobs[next];
+#ifdef ARCADE_NO_STATS
+        searchView(job.report, *job.view, job.term);
+#else
+        chrono::steady_clock::time_point start{ chrono::steady_clock::now() };
+        job.nodesVisited = searchView(job.report, *job.view, job.term);
+        job.nanoseconds = nanosecondsSince(start);
+#endif
+        job.done.store(true);
+    }
+}
+
+//function to print the reports of finished searches (and of the writer's commands before each of them) in batch order,
+//and to let go of the views those searches were using
+void drainSearches(SearchReaders& readers, SharedRecords& shared, ReportSink& report, bool wait)
+{
+    size_t ready{ readers.ready.load() };
+    while (readers.drained < ready)
+    {
+        SearchJob& job = readers.jobs[readers.drained];
+        if (!job.done.load())
+        {
+            if (!wait)
+            {
+                break;
+            }
+            this_thread::yield();
+            continue;
+        }
+        report.stream->write(readers.segments[readers.drained].data(), static_cast<streamsize>(readers.segments[readers.drained].size()));
+        report.stream->write(job.report.buffer.data(), static_cast<streamsize>(job.report.buffer.size()));
+        report.counts.searches += job.report.counts.searches;
+        report.counts.searchMatches += job.report.counts.searchMatches;
+        report.counts.searchesNotFound += job.report.counts.searchesNotFound;
+        string().swap(readers.segments[readers.drained]);
+        string().swap(job.report.buffer);
+        ++readers.drained;
+    }
+
+    //searches are queued in epoch order, so the oldest one not yet answered needs the oldest view
+    while (readers.answered < ready && readers.jobs[readers.answered].done.load())
+    {
+        ++readers.answered;
+    }
+    shared.pinnedEpoch = readers.answered < ready ? readers.jobs[readers.answered].epoch : 0;
+
+    //reports of later commands can go out as soon as every queued search has been printed
+    report.hold = readers.drained < ready;
+}
+
+//function to queue a search for the reader threads, against the view as it is at this point of the batch
+void queueSearch(SearchReaders& readers, SharedRecords& shared, ReportSink& report, string_view searchTerm)
+{
+    size_t index{ readers.ready.load() };
+    SearchJob& job = readers.jobs[index];
+    job.term = searchTerm;
+    job.view = shared.current.load();
+    job.epoch = shared.epoch.load();
+    job.report.quiet = report.quiet;
+    job.report.hold = true;
+
+    //writer's report so far is printed before the search's report
+    readers.segments[index] = move(report.buffer);
+    report.buffer.clear();
+    report.hold = true;
+    if (readers.answered == index)
+    {
+        shared.pinnedEpoch = job.epoch;
+    }
+    readers.ready.store(index + 1);
+}
+
+//function to check that a view is consistent: its size, order and total plays agree with what was published
+bool checkView(const ReadView& view)
+{
+    size_t size{ 0 };
+    long long playsTotal{ 0 };
+    unsigned long long lastOrder{ 0 };
+    for (const ReadChunk* chunk : view.chunks)
+    {
+        if (chunk->records.empty())
+        {
+            return false;
+        }
+        for (const ReadRecord* record : chunk->records)
+        {
+            if (size > 0 && record->data.order <= lastOrder)
+            {
+                return false;
+            }
+            lastOrder = record->data.order;
+            playsTotal += record->data.plays;
+            ++size;
+        }
+    }
+    return size == view.size && playsTotal == view.playsTotal;
+}
+
+//stress test for concurrent readers: reader threads search published views nonstop (checking each view they are
+//given is consistent) while the writer applies the batch's changes over and over, publishing after each one
+//run with 1, 2, 4, ... readers for 'seconds' each; prints searches per second and checks that they go up with the
+//number of readers (as far as there are cores for them); returns false if a check failed
+bool stressReaders(RecordList& list, const Batch& batch, double seconds)
+{
+    //search terms come from the batch (or, without any, from the start of some names)
+    vector<string> terms;
+    vector<const BatchCommand*> changes;
+    for (const BatchCommand& command : batch.commands)
+    {
+        if (command.type == CommandType::Search)
+        {
+            terms.emplace_back();
+            toLowercase(command.name, terms.back());
+        }
+        else if (changesRecords(command.type))
+        {
+            changes.push_back(&command);
+        }
+    }
+    for (GameData* node = firstRecord(list); node != nullptr && terms.size() < 8; node = nextRecord(list, node))
+    {
+        terms.emplace_back();
+        toLowercase(node->name.view().substr(0, 3), terms.back());
+    }
+    if (terms.empty())
+    {
+        terms.push_back("a");
+    }
+
+    unique_ptr<SharedRecords> shared(new SharedRecords);
+    list.shared = shared.get();
+    publishAll(*shared, list);
+
+    unsigned int cores{ thread::hardware_concurrency() > 0 ? thread::hardware_concurrency() : 1 };
+    unsigned int mostReaders{ min<unsigned int>(max(2u, cores), SharedRecords::maxReaders) };
+    cout << "READER STRESS TEST: " << list.size << " records, " << changes.size() << " changing commands, "
+        << terms.size() << " search terms, " << cores << " core(s)\n";
+
+    ReportSink silent;
+    silent.quiet = true;
+    size_t nextChange{ 0 };
+    double singleReaderRate{ 0 };
+    bool passed{ true };
+    for (unsigned int readerCount{ 1 }; readerCount <= mostReaders; readerCount *= 2)
+    {
+        atomic<bool> stop{ false };
+        vector<unsigned long long> searches(readerCount, 0);
+        vector<unsigned long long> badViews(readerCount, 0);
+        vector<thread> readers;
+        for (unsigned int reader{ 0 }; reader < readerCount; ++reader)
+        {
+            readers.emplace_back([&, reader]()
+            {
+                size_t term{ reader };
+                while (!stop.load(memory_order_relaxed))
+                {
+                    const ReadView* view = beginRead(*shared, reader);
+                    string_view lowercaseTerm{ terms[term++ % terms.size()] };
+                    size_t found{ 0 };
+                    for (const ReadChunk* chunk : view->chunks)
+                    {
+                        for (const ReadRecord* record : chunk->records)
+                        {
+                            found += containsIgnoreCase(record->data.name.view(), lowercaseTerm) ? 1 : 0;
+                        }
+                    }
+                    if (found > view->size || ((searches[reader] & 7) == 0 && !checkView(*view)))
+                    {
+                        ++badViews[reader];
+                    }
+                    endRead(*shared, reader);
+                    ++searches[reader];
+                }
+            });
+        }
+
+        //writer: apply changes until time is up
+        unsigned long long published{ 0 };
+        auto start = chrono::steady_clock::now();
+        double elapsed{ 0 };
+        while (elapsed < seconds)
+        {
+            if (!changes.empty())
+            {
+                const BatchCommand& command = *changes[nextChange++ % changes.size()];
+                commandHandlers[static_cast<size_t>(command.type)](list, silent, command);
+                publishChanges(*shared, list);
+                ++published;
+            }
+            else
+            {
+                this_thread::sleep_for(chrono::milliseconds(10));
+            }
+            elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        }
+        stop.store(true);
+        for (thread& reader : readers)
+        {
+            reader.join();
+        }
+        reclaimRetired(*shared);
+
+        unsigned long long totalSearches{ 0 };
+        unsigned long long totalBad{ 0 };
+        for (unsigned int reader{ 0 }; reader < readerCount; ++reader)
+        {
+            totalSearches += searches[reader];
+            totalBad += badViews[reader];
+        }
+        double rate{ static_cast<double>(totalSearches) / elapsed };
+        if (readerCount == 1)
+        {
+            singleReaderRate = rate;
+        }
+        double speedup{ singleReaderRate > 0 ? rate / singleReaderRate : 0 };
+        cout << "readers " << readerCount << ": " << static_cast<unsigned long long>(rate) << " searches/s, speedup "
+            << static_cast<double>(static_cast<long long>(speedup * 100)) / 100 << "x, " << published << " changes published";
+        if (totalBad > 0)
+        {
+            cout << ", " << totalBad << " INCONSISTENT VIEWS";
+            passed = false;
+        }
+        //the writer has a core of its own; readers beyond the remaining cores can't speed anything up
+        if (readerCount > 1 && readerCount < cores && speedup < 0.5 * readerCount)
+        {
+            cout << ", SCALING TOO LOW";
+            passed = false;
+        }
+        cout << '\n';
+    }
+    if (cores < 3)
+    {
+        cout << "(scaling not checked: the writer and a second reader need cores of their own)\n";
+    }
+    cout << (passed ? "STRESS TEST PASSED\n" : "STRESS TEST FAILED\n");
+
+    freeSharedRecords(*shared);
+    list.shared = nullptr;
+    return passed;
+}
+
+#ifdef ARCADE_COUNT_ALLOCATIONS
+//replacements for the global operator new and delete that count every allocation, for --check-allocations (built only
+//with -DARCADE_COUNT_ALLOCATIONS, so other builds don't pay for the count); otherwise they do what the standard
+//library's do. Every plain, array, nothrow and sized form is replaced, so whichever form frees a block, it is freed by
+//the same malloc/free pair that took it. The over-aligned forms are left to the library (they are paired with its own
+//deletes, and only ReaderSlot needs them), so their allocations aren't counted
+//(all kept out of line: once inlined, GCC sees memory from malloc handed to operator delete, or the other way round, and warns)
+#if defined(__GNUC__)
+#define ARCADE_OUT_OF_LINE __attribute__((noinline))
+#else
+#define ARCADE_OUT_OF_LINE
+#endif
+
+//function to take a block for operator new, counting it (nullptr if there's no memory left)
+ARCADE_OUT_OF_LINE void* countedAllocation(size_t size) noexcept
+{
+    heapAllocations.fetch_add(1, memory_order_relaxed);
+    return malloc(size > 0 ? size : 1);
+}
+
+ARCADE_OUT_OF_LINE void* operator new(size_t size)
+{
+    void* memory = countedAllocation(size);
+    if (memory == nullptr)
+    {
+        throw bad_alloc();
+    }
+    return memory;
+}
+
+ARCADE_OUT_OF_LINE void* operator new[](size_t size)
+{
+    void* memory = countedAllocation(size);
+    if (memory == nullptr)
+    {
+        throw bad_alloc();
+    }
+    return memory;
+}
+
+ARCADE_OUT_OF_LINE void* operator new(size_t size, const nothrow_t&) noexcept
+{
+    return countedAllocation(size);
+}
+
+ARCADE_OUT_OF_LINE void* operator new[](size_t size, const nothrow_t&) noexcept
+{
+    return countedAllocation(size);
+}
+
+ARCADE_OUT_OF_LINE void operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+
+ARCADE_OUT_OF_LINE void operator delete[](void* memory) noexcept
+{
+    free(memory);
+}
+
+ARCADE_OUT_OF_LINE void operator delete(void* memory, size_t) noexcept
+{
+    free(memory);
+}
+
+ARCADE_OUT_OF_LINE void operator delete[](void* memory, size_t) noexcept
+{
+    free(memory);
+}
+
+ARCADE_OUT_OF_LINE void operator delete(void* memory, const nothrow_t&) noexcept
+{
+    free(memory);
+}
+
+ARCADE_OUT_OF_LINE void operator delete[](void* memory, const nothrow_t&) noexcept
+{
+    free(memory);
+}
+#undef ARCADE_OUT_OF_LINE
+#endif
+
+//function to check that searches, edits and deletes allocate nothing once the program has warmed up: the batch is run
+//once to build the indexes and grow the buffers, then again with the allocations of every command counted (reports
+//are formatted as usual, then thrown away)
+//blocks the string arena takes are the records' own text storage, which grows 64KB at a time, so they aren't counted
+//prints what each kind of command allocated on 'out'; returns true if no search, edit or delete allocated anything
+bool checkAllocations(RecordList& list, const Batch& batch, ostream& out)
+{
+    ostream discard(nullptr);
+    ReportSink report;
+    report.stream = &discard;
+    size_t adds{ 0 };
+    for (const BatchCommand& command : batch.commands)
+    {
+        commandHandlers[static_cast<size_t>(command.type)](list, report, command);
+        adds += command.type == CommandType::Add ? 1 : 0;
+    }
+
+    //the counted run adds its records again, so the warm-up run can't have grown the buffers that hold some of the
+    //records far enough: they get room for every record the list can have by the end, and the report buffer (which
+    //the warm-up run left partly full) room for a whole flush and one more large write
+    flushReport(report);
+    report.buffer.reserve(report.flushSize + (64 << 10));
+    list.searchMatches.reserve(list.size + adds);
+    list.repriceOverflows.reserve(list.size + adds);
+
+    const size_t types{ sizeof(commandHandlers) / sizeof(commandHandlers[0]) };
+    size_t commands[types] = {};           //commands of each type run
+    size_t allocating[types] = {};         //commands of each type that allocated anything
+    unsigned long long allocations[types] = {};  //allocations commands of each type made altogether
+    for (const BatchCommand& command : batch.commands)
+    {
+        size_t type{ static_cast<size_t>(command.type) };
+        size_t arenaBlocks{ list.arena.blocks.size() };
+        size_t arenaCapacity{ list.arena.blocks.capacity() };
+        bool indexed{ list.searchIndex.built };
+        unsigned long long before{ heapAllocations.load(memory_order_relaxed) };
+        commandHandlers[type](list, report, command);
+        unsigned long long made{ heapAllocations.load(memory_order_relaxed) - before };
+        made -= list.arena.blocks.size() - arenaBlocks + (list.arena.blocks.capacity() != arenaCapacity ? 1 : 0);
+
+        //a search that has to build the search index again (after a sort moved the records) is finishing the sort's work
+        if (!indexed && list.searchIndex.built)
+        {
+            allocations[static_cast<size_t>(CommandType::Sort)] += made;
+            made = 0;
+        }
+        ++commands[type];
+        allocating[type] += made > 0 ? 1 : 0;
+        allocations[type] += made;
+    }
+    flushReport(report);
+
+    bool passed{ true };
+    char line[256];
+    out << "ALLOCATION CHECK: " << list.size << " records, " << batch.commands.size() << " commands (after a warm-up run)\n";
+    snprintf(line, sizeof(line), "%-10s %10s %12s %12s\n", "command", "count", "allocating", "allocations");
+    out << line;
+    for (size_t type{ 1 }; type < types; ++type)
+    {
+        if (commands[type] == 0)
+        {
+            continue;
+        }
+        snprintf(line, sizeof(line), "%-10s %10zu %12zu %12llu\n", commandNames[type], commands[type], allocating[type], allocations[type]);
+        out << line;
+        CommandType kind{ static_cast<CommandType>(type) };
+        if ((kind == CommandType::Search || kind == CommandType::Edit || kind == CommandType::Delete) && allocating[type] > 0)
+        {
+            passed = false;
+        }
+    }
+    out << (passed ? "ALLOCATION CHECK PASSED\n" : "ALLOCATION CHECK FAILED\n");
+    return passed;
+}
+
+//function to take the next number of a sequence of pseudo-random numbers (splitmix64), advancing 'state'
+//the synthetic workload is made only from these, so the same seed always gives the same files
+uint64_t nextRandom(uint64_t& state)
+{
+    uint64_t value{ state += 0x9e3779b97f4a7c15ULL };
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+//function to get a pseudo-random number from 0 to limit-1
+uint64_t randomBelow(uint64_t& state, uint64_t limit)
+{
+    return nextRandom(state) % limit;
+}
+
+//function to get the starting state of the random numbers for one item (record or command) of the synthetic workload,
+//so any item can be made again on its own (the batch generator names records without keeping a list of them)
+uint64_t randomStateFor(uint64_t seed, uint64_t stream, uint64_t index)
+{
+    uint64_t state{ seed ^ (stream << 56) };
+    state ^= nextRandom(state) + index;
+    nextRandom(state);
+    return state;
+}
+
+//function to make the name of the index'th synthetic record (records added by the batch continue the numbering)
+//names are one to three arcade-sounding words, now and then with a sequel number, like "Mega Kong II"
+string syntheticName(uint64_t seed, uint64_t index)
+{
+    static const char* const words[] = { "Pac", "Man", "Donkey", "Kong", "Spy", "Hunter", "Zaxxon", "Kangaroo",
+        "Galaga", "Tron", "Robotron", "Defender", "Joust", "Qix", "Frogger", "Asteroids", "Centipede", "Tempest",
+        "Dig", "Dug", "Burger", "Time", "Pilot", "Star", "Wars", "Mega", "Super", "Space", "Invaders", "Missile",
+        "Command", "Street", "Fighter", "Dragon", "Ninja", "Turtles", "Galaxian", "Rally", "Bomb", "Jack" };
+    static const char* const sequels[] = { " II", " III", " Jr.", " Deluxe", " 2000" };
+    const uint64_t wordCount{ sizeof(words) / sizeof(words[0]) };
+
+    uint64_t state{ randomStateFor(seed, 1, index) };
+    string name{ words[randomBelow(state, wordCount)] };
+    for (uint64_t extra{ randomBelow(state, 3) }; extra > 0; --extra)
+    {
+        name += randomBelow(state, 4) == 0 ? '-' : ' ';
+        name += words[randomBelow(state, wordCount)];
+    }
+    if (randomBelow(state, 8) == 0)
+    {
+        name += sequels[randomBelow(state, sizeof(sequels) / sizeof(sequels[0]))];
+    }
+    return name;
+}
+
+//function to add synthetic initials (usually three letters) to 'text'
+void appendSyntheticInitials(string& text, uint64_t& state)
+{
+    for (uint64_t letters{ randomBelow(state, 5) == 0 ? 2u : 3u }; letters > 0; --letters)
+    {
+        text += static_cast<char>('A' + randomBelow(state, 26));
+    }
+}
+
+//function to add a whole number to 'text', now and then with leading zeros (as some database files have)
+void appendSyntheticNumber(string& text, uint64_t& state, long long value)
+{
+    if (randomBelow(state, 20) == 0)
+    {
+        text.append(1 + randomBelow(state, 3), '0');
+    }
+    text += to_string(value);
+}
+
+//function to get a name in another case than it is written in (every letter's case swapped)
+string syntheticOtherCase(const string& name)
+{
+    string other{ name };
+    for (char& c : other)
+    {
+        c = static_cast<char>(isupper(static_cast<unsigned char>(c)) ? tolower(static_cast<unsigned char>(c)) : toupper(static_cast<unsigned char>(c)));
+    }
+    return other;
+}
+
+//function to add the index'th synthetic database line to 'text'; revenue is 25 cents a play, written the ways
+//db.txt writes it ("$62.50", "$002499.7500")
+void appendSyntheticRecord(string& text, uint64_t seed, uint64_t index)
+{
+    uint64_t state{ randomStateFor(seed, 2, index) };
+    text += syntheticName(seed, index);
+    text += ", ";
+    appendSyntheticNumber(text, state, static_cast<long long>(randomBelow(state, 1000) * randomBelow(state, 1000000)));
+    text += ", ";
+    appendSyntheticInitials(text, state);
+    text += ", ";
+    long long plays{ static_cast<long long>(randomBelow(state, 8) == 0 ? randomBelow(state, 100000) : randomBelow(state, 5000)) };
+    text += to_string(plays);
+    text += ", $";
+
+    char revenue[48];
+    long long cents{ plays * 25 };
+    uint64_t style{ randomBelow(state, 10) };
+    if (style < 6)
+    {
+        snprintf(revenue, sizeof(revenue), "%lld.%02lld", cents / 100, cents % 100);
+    }
+    else if (style < 8)
+    {
+        snprintf(revenue, sizeof(revenue), "%06lld.%02lld00", cents / 100, cents % 100);
+    }
+    else
+    {
+        snprintf(revenue, sizeof(revenue), "%lld.%02lld00", cents / 100, cents % 100);
+    }
+    text += revenue;
+    text += '\n';
+}
+
+//function to add the index'th synthetic batch command to 'text'
+//'records' counts the records in the database plus those the batch has added so far (updated by add commands)
+void appendSyntheticCommand(string& text, uint64_t seed, uint64_t index, uint64_t& records, const unsigned int mix[5])
+{
+    uint64_t state{ randomStateFor(seed, 3, index) };
+    uint64_t total{ uint64_t{ mix[0] } + mix[1] + mix[2] + mix[3] + mix[4] };
+    uint64_t pick{ randomBelow(state, total) };
+    size_t type{ 0 };
+    while (pick >= mix[type])
+    {
+        pick -= mix[type++];
+    }
+
+    //commands name a record of the database or one the batch added (which may since have been deleted)
+    string name{ syntheticName(seed, records > 0 ? randomBelow(state, records) : 0) };
+    switch (type)
+    {
+    case 0:
+    {
+        //add a record with a new name, the way a batch file writes it
+        long long plays{ static_cast<long long>(randomBelow(state, 5000)) };
+        char revenue[48];
+        snprintf(revenue, sizeof(revenue), "%03lld.%02lld00", plays * 25 / 100, plays * 25 % 100);
+        text += "1 \"" + syntheticName(seed, records) + "\" " + to_string(randomBelow(state, 1000000)) + ' ';
+        appendSyntheticInitials(text, state);
+        text += ' ' + to_string(plays) + " $" + revenue + '\n';
+        ++records;
+        break;
+    }
+    case 1:
+    {
+        //search for a name or a long part of one (or, now and then, something no name contains)
+        size_t length{ min(name.size(), static_cast<size_t>(8 + randomBelow(state, 8))) };
+        size_t start{ static_cast<size_t>(randomBelow(state, name.size() - length + 1)) };
+        text += "2 " + (randomBelow(state, 20) == 0 ? string("Zzyzx") : name.substr(start, length)) + '\n';
+        break;
+    }
+    case 2:
+    {
+        //now and then the name is in another case (which edits don't match), the field number is not one of 1-3,
+        //or the number has leading zeros or (for plays) a fraction
+        uint64_t field{ randomBelow(state, 20) == 0 ? 4 + randomBelow(state, 6) : 1 + randomBelow(state, 3) };
+        text += "3 \"" + (randomBelow(state, 10) == 0 ? syntheticOtherCase(name) : name) + "\" " + to_string(field) + ' ';
+        if (field == 2)
+        {
+            appendSyntheticInitials(text, state);
+        }
+        else
+        {
+            appendSyntheticNumber(text, state, static_cast<long long>(randomBelow(state, field == 1 ? 100000000 : 5000)));
+            if (field == 3 && randomBelow(state, 20) == 0)
+            {
+                text += '.';
+                text += static_cast<char>('0' + randomBelow(state, 10));
+            }
+        }
+        text += '\n';
+        break;
+    }
+    case 3:
+        //deletes match names in any case
+        text += "4 " + (randomBelow(state, 10) == 0 ? syntheticOtherCase(name) : name) + '\n';
+        break;
+    default:
+    {
+        //now and then the method is one the program doesn't know, or written in one of the other ways it accepts
+        static const char* const keys[] = { "name", "plays", "highscore", "revenue", "initials" };
+        static const char* const otherMethods[] = { "plays ", "name  desc", "revenue desc ", "Plays", "score", "highscore up",
+            "initials asc", "revenue ascending", "name descending", "" };
+        if (randomBelow(state, 10) == 0)
+        {
+            text += string("5 ") + otherMethods[randomBelow(state, sizeof(otherMethods) / sizeof(otherMethods[0]))] + '\n';
+        }
+        else
+        {
+            text += string("5 ") + keys[randomBelow(state, 5)] + (randomBelow(state, 3) == 0 ? " desc" : "") + '\n';
+        }
+        break;
+    }
+    }
+}
+
+//function to write a synthetic database of 'records' records and a batch file of 'commands' commands,
+//mixing add, search, edit, delete and sort commands in the proportions of 'mix'; returns false if a file can't be written
+bool generateWorkload(uint64_t records, uint64_t commands, const string& database, const string& batch, const unsigned int mix[5], uint64_t seed)
+{
+    if (uint64_t{ mix[0] } + mix[1] + mix[2] + mix[3] + mix[4] == 0)
+    {
+        cerr << "command mix must have at least one command type with a weight above 0.\n";
+        return false;
+    }
+
+    //lines are formatted into a buffer that is written out whenever it fills up
+    const size_t flushSize{ 1 << 20 };
+    string text;
+    text.reserve(flushSize + 4096);
+    ofstream databaseFile(database, ios::out | ios::binary);
+    for (uint64_t index{ 0 }; index < records && databaseFile; ++index)
+    {
+        appendSyntheticRecord(text, seed, index);
+        if (text.size() >= flushSize)
+        {
+            databaseFile.write(text.data(), static_cast<streamsize>(text.size()));
+            text.clear();
+        }
+    }
+    databaseFile.write(text.data(), static_cast<streamsize>(text.size()));
+    databaseFile.close();
+    text.clear();
+
+    ofstream batchFile(batch, ios::out | ios::binary);
+    uint64_t knownRecords{ records };
+    for (uint64_t index{ 0 }; index < commands && batchFile; ++index)
+    {
+        appendSyntheticCommand(text, seed, index, knownRecords, mix);
+        if (text.size() >= flushSize)
+        {
+            batchFile.write(text.data(), static_cast<streamsize>(text.size()));
+            text.clear();
+        }
+    }
+    batchFile.write(text.data(), static_cast<streamsize>(text.size()));
+    batchFile.close();
+
+    if (!databaseFile || !batchFile)
+    {
+        cerr << "generated workload could not be written.\n";
+        return false;
+    }
+    return true;
+}
+
+//function to get the most memory the program has had resident at once, in KB (0 where the system can't tell)
+long long peakResidentKB()
+{
+#ifndef _WIN32
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return static_cast<long long>(usage.ru_maxrss) / 1024;
+#else
+    return static_cast<long long>(usage.ru_maxrss);
+#endif
+#else
+    return 0;
+#endif
+}
+
+//function to get the time at a fraction (0 to 1) of the way through a sorted list of times (nearest rank)
+double timeAtFraction(const vector<double>& sortedSeconds, double fraction)
+{
+    size_t rank{ static_cast<size_t>(ceil(fraction * static_cast<double>(sortedSeconds.size()))) };
+    return sortedSeconds[min(max(rank, size_t{ 1 }), sortedSeconds.size()) - 1];
+}
+
+//function to benchmark a batch: times loading the database, every command of the batch (each kind separately)
+//and writing freeplay.dat, then prints throughput, latency percentiles and peak memory instead of the reports
+//(the commands still format their reports, which are then thrown away); returns false if the database can't be read
+bool runBenchmark(const string& database, const Batch& batch, const ProgramOptions& options)
+{
+    using Clock = chrono::steady_clock;
+    auto secondsSince = [](Clock::time_point start) { return chrono::duration<double>(Clock::now() - start).count(); };
+
+    RecordList list;
+#ifndef ARCADE_CONTIGUOUS_STORE
+    list.pool.useHeap = options.heapNodes;
+#endif
+    DatabaseFormat format{ DatabaseFormat::Text };
+    Clock::time_point start{ Clock::now() };
+    if (!createLinkedList(list, database, options.loadThreads, format))
+    {
+        cerr << "datafile could not be read.\n";
+        return false;
+    }
+    double loadSeconds{ secondsSince(start) };
+    size_t loadedRecords{ list.size };
+
+    //run every command, timing each one; reports go to a stream with nowhere to write to
+    ostream discard(nullptr);
+    ReportSink report;
+    report.stream = &discard;
+    vector<double> seconds[sizeof(commandHandlers) / sizeof(commandHandlers[0])];
+    for (const BatchCommand& command : batch.commands)
+    {
+        size_t type{ static_cast<size_t>(command.type) };
+        start = Clock::now();
+        commandHandlers[type](list, report, command);
+        seconds[type].push_back(secondsSince(start));
+    }
+    flushReport(report);
+
+    start = Clock::now();
+    bool written{ writeRecordsToFile(list, "freeplay.dat", options.atomicWrite, DatabaseFormat::Text) };
+    double writeSeconds{ secondsSince(start) };
+
+    //print results: a line for loading, one for each kind of command the batch had, and one for writing
+    char line[256];
+    cout << "BENCHMARK: " << loadedRecords << " records, " << batch.commands.size() << " commands\n";
+    snprintf(line, sizeof(line), "%-10s %10zu records %10.2f ms %12.0f records/s\n", "load", loadedRecords,
+        loadSeconds * 1e3, loadSeconds > 0 ? static_cast<double>(loadedRecords) / loadSeconds : 0.0);
+    cout << line;
+    snprintf(line, sizeof(line), "%-10s %10s %12s %12s %12s %12s %12s\n", "command", "count", "ops/s", "p50 us", "p90 us", "p99 us", "max us");
+    cout << line;
+    for (size_t type{ 1 }; type < sizeof(seconds) / sizeof(seconds[0]); ++type)
+    {
+        vector<double>& times = seconds[type];
+        if (times.empty())
+        {
+            continue;
+        }
+        double total{ 0 };
+        for (double time : times)
+        {
+            total += time;
+        }
+        sort(times.begin(), times.end());
+        snprintf(line, sizeof(line), "%-10s %10zu %12.0f %12.2f %12.2f %12.2f %12.2f\n", commandNames[type], times.size(),
+            total > 0 ? static_cast<double>(times.size()) / total : 0.0, timeAtFraction(times, 0.5) * 1e6,
+            timeAtFraction(times, 0.9) * 1e6, timeAtFraction(times, 0.99) * 1e6, times.back() * 1e6);
+        cout << line;
+    }
+    snprintf(line, sizeof(line), "%-10s %10zu records %10.2f ms %12.0f records/s\n", "write", list.size,
+        writeSeconds * 1e3, writeSeconds > 0 ? static_cast<double>(list.size) / writeSeconds : 0.0);
+    cout << line;
+    cout << "peak RSS: " << peakResidentKB() << " KB\n" << flush;
+
+    freeAllRecords(list);
+    return written;
+}
+
+//functions of the reference engine, which --check-reference runs every workload through: the program as it was first
+//written, with each field kept as the text it prints as and every command walking the list from the head
+//its output is what the engine has to match byte for byte; besides printing to a stream, the only changes are that it
+//sorts by every key and direction the engine takes, with a stable sort instead of bubble sort (which gives the same order)
+
+//function to convert string to lowercase
+string referenceLowercase(string original)
+{
+    for (size_t i{ 0 }; i < original.size(); ++i)
+    {
+        original[i] = static_cast<char>(tolower(static_cast<unsigned char>(original[i])));
+    }
+    return original;
+}
+
+//function to remove leading zeros from string (a string of only zeros, or an empty one, becomes "0")
+string referenceCutLeadingZeroes(string original)
+{
+    for (size_t i{ 0 }; i < original.size(); ++i)
+    {
+        if (original[i] != '0')
+        {
+            return original.substr(i);
+        }
+    }
+    return "0";
+}
+
+//function to format an amount of revenue with two decimals (as fixed/setprecision(2) stream formatting does)
+string referenceRevenue(double value)
+{
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer), "%.2f", value);
+    return buffer;
+}
+
+//function to read data from database file and create linked list of reference records
+void referenceLoad(ReferenceRecord*& head, const string& database)
+{
+    ifstream datfile(database, ios::in | ios::binary);
+    ReferenceRecord* tail = nullptr;
+    string datfileLine;
+    while (getline(datfile, datfileLine))
+    {
+        //extract fields at the commas, then drop the space after each comma (and the $ of revenue)
+        stringstream line(datfileLine);
+        string name, highScore, initials, plays, revenue;
+        getline(line, name, ',');
+        getline(line, highScore, ',');
+        getline(line, initials, ',');
+        getline(line, plays, ',');
+        getline(line, revenue, ',');
+
+        //high score and plays lose their leading zeroes, and revenue is printed with two decimals
+        ReferenceRecord* newGame = new ReferenceRecord
+        {
+            name,
+            referenceCutLeadingZeroes(highScore.substr(1)),
+            initials.substr(1),
+            referenceCutLeadingZeroes(plays.substr(1)),
+            referenceRevenue(stod(revenue.substr(2))),
+            nullptr
+        };
+        if (head == nullptr)
+        {
+            head = newGame;
+        }
+        else
+        {
+            tail->next = newGame;
+        }
+        tail = newGame;
+    }
+}
+
+//function to add new record to end of linked list (walking to the end to find it)
+void referenceAdd(ReferenceRecord*& head, ostream& out, const string& commandLine)
+{
+    //name is between the double quotes; the other fields follow it, separated by spaces (revenue after a $)
+    size_t doubleQuote1{ commandLine.find('\"') };
+    size_t doubleQuote2{ commandLine.find('\"', doubleQuote1 + 1) };
+    size_t space1{ commandLine.find(' ', doubleQuote2) };
+    size_t space2{ commandLine.find(' ', space1 + 1) };
+    size_t space3{ commandLine.find(' ', space2 + 1) };
+    size_t space4{ commandLine.find(' ', space3 + 1) };
+    string name{ commandLine.substr(doubleQuote1 + 1, doubleQuote2 - (doubleQuote1 + 1)) };
+    string highScore{ commandLine.substr(space1 + 1, space2 - (space1 + 1)) };
+    string initials{ commandLine.substr(space2 + 1, space3 - (space2 + 1)) };
+    string plays{ commandLine.substr(space3 + 1, space4 - (space3 + 1)) };
+    string revenue{ commandLine.substr(space4 + 2) };
+
+    ReferenceRecord* newGame = new ReferenceRecord{ name, highScore, initials, plays, revenue, nullptr };
+    if (head == nullptr)
+    {
+        head = newGame;
+    }
+    else
+    {
+        ReferenceRecord* currentNode = head;
+        while (currentNode->next != nullptr)
+        {
+            currentNode = currentNode->next;
+        }
+        currentNode->next = newGame;
+    }
+
+    out << "RECORD ADDED\n" << "Name: " << name << '\n'
+        << "High Score: " << highScore << '\n'
+        << "Initials: " << initials << '\n'
+        << "Plays: " << plays << '\n'
+        << "Revenue: " << '$' << revenue << '\n' << '\n';
+}
+
+//function to search for records whose name contains a search term (ignoring case)
+void referenceSearch(ReferenceRecord* head, ostream& out, const string& searchTerm)
+{
+    bool searchTermFound{ false };
+    for (ReferenceRecord* currentNode = head; currentNode != nullptr; currentNode = currentNode->next)
+    {
+        if (referenceLowercase(currentNode->name).find(referenceLowercase(searchTerm)) != string::npos)
+        {
+            searchTermFound = true;
+            out << currentNode->name << " FOUND\n"
+                << "High Score: " << currentNode->highScore << '\n'
+                << "Initials: " << currentNode->initials << '\n'
+                << "Plays: " << currentNode->plays << '\n'
+                << "Revenue: " << '$' << currentNode->revenue << '\n' << '\n';
+        }
+    }
+    if (!searchTermFound)
+    {
+        out << searchTerm << " NOT FOUND\n";
+    }
+}
+
+//function to edit the first record with exactly the given name (field 1 is high score, 2 initials, 3 plays and revenue)
+//as first written, a field number other than 1-3 edits nothing but still counts the name as found
+void referenceEdit(ReferenceRecord* head, ostream& out, const string& commandLine)
+{
+    size_t doubleQuote1{ commandLine.find('\"') };
+    size_t doubleQuote2{ commandLine.find('\"', doubleQuote1 + 1) };
+    string batchfileName{ commandLine.substr(doubleQuote1 + 1, doubleQuote2 - (doubleQuote1 + 1)) };
+    size_t space1{ commandLine.find(' ', doubleQuote2) };
+    size_t space2{ commandLine.find(' ', space1 + 1) };
+    string fieldNumber{ commandLine.substr(space1 + 1, 1) };
+    string newValue{ commandLine.substr(space2 + 1) };
+
+    bool foundNameToEdit{ false };
+    for (ReferenceRecord* currentNode = head; currentNode != nullptr; currentNode = currentNode->next)
+    {
+        if (batchfileName != currentNode->name)
+        {
+            continue;
+        }
+        foundNameToEdit = true;
+        if (fieldNumber == "1")
+        {
+            currentNode->highScore = newValue;
+            out << currentNode->name << " UPDATED\n"
+                << "UPDATE TO high score - VALUE " << referenceCutLeadingZeroes(newValue) << '\n'
+                << "Name: " << currentNode->name << '\n'
+                << "High Score: " << referenceCutLeadingZeroes(newValue) << '\n'
+                << "Initials: " << currentNode->initials << '\n'
+                << "Plays: " << currentNode->plays << '\n'
+                << "Revenue: " << '$' << currentNode->revenue << '\n' << '\n';
+            break;
+        }
+        else if (fieldNumber == "2")
+        {
+            currentNode->initials = newValue;
+            out << currentNode->name << " UPDATED\n"
+                << "UPDATE TO initials - VALUE " << newValue << '\n'
+                << "Name: " << currentNode->name << '\n'
+                << "High Score: " << currentNode->highScore << '\n'
+                << "Initials: " << newValue << '\n'
+                << "Plays: " << currentNode->plays << '\n'
+                << "Revenue: " << '$' << currentNode->revenue << '\n' << '\n';
+            break;
+        }
+        else if (fieldNumber == "3")
+        {
+            currentNode->plays = newValue;
+            currentNode->revenue = referenceRevenue(stod(newValue) * 0.25);
+            out << currentNode->name << " UPDATED\n"
+                << "UPDATE TO plays - VALUE " << referenceCutLeadingZeroes(newValue) << '\n'
+                << "Name: " << currentNode->name << '\n'
+                << "High Score: " << currentNode->highScore << '\n'
+                << "Initials: " << currentNode->initials << '\n'
+                << "Plays: " << referenceCutLeadingZeroes(newValue) << '\n'
+                << "Revenue: " << '$' << currentNode->revenue << '\n' << '\n';
+            break;
+        }
+    }
+    if (!foundNameToEdit)
+    {
+        out << "Record to edit was not found.\n";
+    }
+}
+
+//function to delete the first record whose name matches (ignoring case)
+void referenceDelete(ReferenceRecord*& head, ostream& out, const string& recordToDelete)
+{
+    ReferenceRecord* previousNode = nullptr;
+    for (ReferenceRecord* currentNode = head; currentNode != nullptr; previousNode = currentNode, currentNode = currentNode->next)
+    {
+        if (referenceLowercase(currentNode->name) == referenceLowercase(recordToDelete))
+        {
+            if (previousNode == nullptr)
+            {
+                head = currentNode->next;
+            }
+            else
+            {
+                previousNode->next = currentNode->next;
+            }
+            out << "RECORD DELETED\n"
+                << "Name: " << currentNode->name << '\n'
+                << "High Score: " << currentNode->highScore << '\n'
+                << "Initials: " << currentNode->initials << '\n'
+                << "Plays: " << currentNode->plays << '\n'
+                << "Revenue: " << '$' << currentNode->revenue << '\n' << '\n';
+            delete currentNode;
+            return;
+        }
+    }
+    out << "Record to delete was not found in the database file.\n";
+}
+
+//function to sort the list by a sort method ("plays", "name desc", ...) and print it
+//an unknown method leaves the list as it is, and is printed as plays
+void referenceSort(ReferenceRecord*& head, ostream& out, const string& sortMethod)
+{
+    vector<ReferenceRecord*> records;
+    for (ReferenceRecord* node = head; node != nullptr; node = node->next)
+    {
+        records.push_back(node);
+    }
+    if (records.size() < 2)
+    {
+        return;
+    }
+
+    size_t space{ sortMethod.find(' ') };
+    string key{ sortMethod.substr(0, space) };
+    string direction{ space == string::npos ? "" : sortMethod.substr(space + 1) };
+    bool descending{ direction == "desc" || direction == "descending" };
+    bool known{ (space == string::npos || direction == "asc" || direction == "ascending" || descending)
+        && (key == "name" || key == "plays" || key == "highscore" || key == "revenue" || key == "initials") };
+
+    //numbers are compared by value, revenue in cents
+    auto before = [&key](const ReferenceRecord* a, const ReferenceRecord* b)
+    {
+        if (key == "name")
+        {
+            return a->name < b->name;
+        }
+        if (key == "initials")
+        {
+            return a->initials < b->initials;
+        }
+        if (key == "plays")
+        {
+            return stoll(a->plays) < stoll(b->plays);
+        }
+        if (key == "highscore")
+        {
+            return stoll(a->highScore) < stoll(b->highScore);
+        }
+        return llround(stod(a->revenue) * 100) < llround(stod(b->revenue) * 100);
+    };
+    if (known)
+    {
+        if (descending)
+        {
+            stable_sort(records.begin(), records.end(), [&before](const ReferenceRecord* a, const ReferenceRecord* b) { return before(b, a); });
+        }
+        else
+        {
+            stable_sort(records.begin(), records.end(), before);
+        }
+        for (size_t i{ 0 }; i + 1 < records.size(); ++i)
+        {
+            records[i]->next = records[i + 1];
+        }
+        records.back()->next = nullptr;
+        head = records.front();
+    }
+
+    out << "RECORDS SORTED BY " << (known ? key : string("plays")) << (descending ? " DESCENDING" : "") << '\n';
+    for (ReferenceRecord* node = head; node != nullptr; node = node->next)
+    {
+        out << node->name << ", " << node->highScore << ", " << node->initials
+            << ", " << node->plays << ", $" << node->revenue << '\n';
+    }
+    out << '\n';
+}
+
+//function to write the list to a file, one record per line
+void referenceSave(ReferenceRecord* head, const string& filename)
+{
+    ofstream outputFile(filename);
+    for (ReferenceRecord* node = head; node != nullptr; node = node->next)
+    {
+        outputFile << node->name << ", " << node->highScore << ", " << node->initials
+            << ", " << node->plays << ", $" << node->revenue << '\n';
+    }
+}
+
+//function to run a batch file through the reference engine, the way the program first ran it: every line is
+//dispatched on its first character as it is read, and freeplay.dat is written at the end
+void runReference(const string& database, const string& batchFile, EngineRun& run)
+{
+    chrono::steady_clock::time_point start{ chrono::steady_clock::now() };
+    ostringstream out;
+    ifstream batchfile(batchFile, ios::in | ios::binary);
+    ReferenceRecord* head = nullptr;
+    referenceLoad(head, database);
+
+    string commandLine;
+    while (getline(batchfile, commandLine))
+    {
+        switch (commandLine.empty() ? '\0' : commandLine[0])
+        {
+        case '1':
+            referenceAdd(head, out, commandLine);
+            break;
+        case '2':
+            referenceSearch(head, out, commandLine.substr(2));
+            break;
+        case '3':
+            referenceEdit(head, out, commandLine);
+            break;
+        case '4':
+            referenceDelete(head, out, commandLine.substr(2));
+            break;
+        case '5':
+            referenceSort(head, out, commandLine.substr(2));
+            break;
+        }
+    }
+    referenceSave(head, "freeplay.dat");
+    run.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    while (head != nullptr)
+    {
+        ReferenceRecord* next = head->next;
+        delete head;
+        head = next;
+    }
+    run.report = out.str();
+    run.ran = readWholeFile("freeplay.dat", run.saved);
+}
+
+//function to run a batch file through the engine the way one of its paths runs it, as a run of the program would
+//(with reports kept instead of printed); returns false if a file could not be read or written
+bool runEnginePath(EnginePath path, const string& database, const string& batchFile, EngineRun& run)
+{
+    chrono::steady_clock::time_point start{ chrono::steady_clock::now() };
+    ostringstream out;
+    ReportSink report;
+    report.stream = &out;
+    Batch batch;
+    if (!mapFile(batchFile, batch.file))
+    {
+        return false;
+    }
+    //workloads have unknown sort methods on purpose, so the warnings about them are left out of the check's output
+    ostringstream warnings;
+    parseBatch(batch, warnings);
+
+    if (path == EnginePath::Stream)
+    {
+        //chunks are small, so even the smallest workload is streamed through several of them
+        ProgramOptions options;
+        options.streamBytes = 64 * 1024;
+        bool streamed = streamBatch(database, batch, report, options);
+        flushReport(report);
+        run.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (!streamed)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        RecordList list;
+        DatabaseFormat format{ DatabaseFormat::Text };
+        if (!createLinkedList(list, database, 1, format))
+        {
+            return false;
+        }
+        Journal journal;
+        RunStats stats;
+        if (path == EnginePath::Shards)
+        {
+            runShardedBatch(list, report, journal, batch, 4);
+        }
+        else
+        {
+            runBatch(list, report, journal, batch, path == EnginePath::Readers ? 2 : 0, stats);
+        }
+        flushReport(report);
+        bool written = writeRecordsToFile(list, "freeplay.dat", false, DatabaseFormat::Text);
+        run.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        freeAllRecords(list);
+        if (!written)
+        {
+            return false;
+        }
+    }
+    run.report = out.str();
+    run.ran = readWholeFile("freeplay.dat", run.saved);
+    return run.ran;
+}
+
+//function to read a whole file into 'contents'; returns false if it can't be read
+bool readWholeFile(const string& filename, string& contents)
+{
+    ifstream file(filename, ios::in | ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    ostringstream text;
+    text << file.rdbuf();
+    contents = text.str();
+    return true;
+}
+
+//function to get the number of the first line where two texts differ (counting from 1)
+size_t firstDifferentLine(const string& a, const string& b)
+{
+    size_t line{ 1 };
+    for (size_t i{ 0 }; i < a.size() && i < b.size() && a[i] == b[i]; ++i)
+    {
+        line += a[i] == '\n' ? 1 : 0;
+    }
+    return line;
+}
+
+//function to run one workload (already written to 'database' and 'batchFile') through the reference engine and every
+//path of the engine: each path's reports and freeplay.dat have to be byte for byte the reference's, and if 'timed', it
+//has to take less time than the reference (in builds that count allocations, the workload has to pass the allocation
+//check too)
+//the reference engine reads 'referenceDatabase', which holds the records of 'database' written the way it can read them
+//a workload of commands the reference engine doesn't have (it skips them) gives the report every path has to print in
+//'expectedReport', and only runs on the paths that run every command (not on shards or a stream)
+//prints a line for each run, labelled 'workload', with its time as a fraction of the reference's; returns true if every
+//path passed
+bool checkWorkload(const string& workload, uint64_t records, uint64_t commands, const string& database, const string& referenceDatabase,
+    const string& batchFile, bool timed, const char* expectedReport)
+{
+    char line[256];
+    EngineRun reference;
+    runReference(referenceDatabase, batchFile, reference);
+    if (expectedReport != nullptr)
+    {
+        reference.report = expectedReport;
+    }
+    snprintf(line, sizeof(line), "%-9s %8llu %9llu  %-10s %10.2f %7.3f\n", workload.c_str(), static_cast<unsigned long long>(records),
+        static_cast<unsigned long long>(commands), "reference", reference.seconds * 1e3, 1.0);
+    cout << line << flush;
+    if (!reference.ran)
+    {
+        cerr << "freeplay.dat could not be read back.\n";
+        return false;
+    }
+
+    bool passed{ true };
+    for (size_t path{ 0 }; path < sizeof(enginePathNames) / sizeof(enginePathNames[0]); ++path)
+    {
+        if (expectedReport != nullptr && (static_cast<EnginePath>(path) == EnginePath::Shards || static_cast<EnginePath>(path) == EnginePath::Stream))
+        {
+            continue;
+        }
+        EngineRun run;
+        const char* result{ "same" };
+        if (!runEnginePath(static_cast<EnginePath>(path), database, batchFile, run))
+        {
+            result = "DID NOT RUN";
+        }
+        else if (run.report != reference.report)
+        {
+            result = "REPORT DIFFERS";
+            cerr << enginePathNames[path] << ": report differs from the reference at line " << firstDifferentLine(run.report, reference.report) << '\n';
+        }
+        else if (run.saved != reference.saved)
+        {
+            result = "FREEPLAY.DAT DIFFERS";
+            cerr << enginePathNames[path] << ": freeplay.dat differs from the reference at line " << firstDifferentLine(run.saved, reference.saved) << '\n';
+        }
+        else if (timed)
+        {
+            //a path that comes out slower is timed twice more, and its best time counts (so one slow run on a
+            //busy machine doesn't fail the check)
+            for (int retry{ 0 }; retry < 2 && run.seconds > reference.seconds; ++retry)
+            {
+                EngineRun again;
+                if (runEnginePath(static_cast<EnginePath>(path), database, batchFile, again))
+                {
+                    run.seconds = min(run.seconds, again.seconds);
+                }
+            }
+            if (run.seconds > reference.seconds)
+            {
+                result = "SLOWER";
+            }
+        }
+        passed = passed && strcmp(result, "same") == 0;
+
+        snprintf(line, sizeof(line), "%-9s %8llu %9llu  %-10s %10.2f %7.3f  %s\n", workload.c_str(), static_cast<unsigned long long>(records),
+            static_cast<unsigned long long>(commands), enginePathNames[path], run.seconds * 1e3,
+            reference.seconds > 0 ? run.seconds / reference.seconds : 0.0, result);
+        cout << line << flush;
+    }
+
+#ifdef ARCADE_COUNT_ALLOCATIONS
+    //the allocation check's table is left out; only whether it passed is printed
+    RecordList list;
+    DatabaseFormat format{ DatabaseFormat::Text };
+    Batch batch;
+    const char* result{ "DID NOT RUN" };
+    if (mapFile(batchFile, batch.file) && createLinkedList(list, database, 1, format))
+    {
+        ostringstream unprinted;
+        parseBatch(batch, unprinted);
+        result = checkAllocations(list, batch, unprinted) ? "none" : "ALLOCATES";
+        freeAllRecords(list);
+    }
+    passed = passed && strcmp(result, "none") == 0;
+    snprintf(line, sizeof(line), "%-9s %8llu %9llu  %-10s %10s %7s  %s\n", workload.c_str(), static_cast<unsigned long long>(records),
+        static_cast<unsigned long long>(commands), "allocation", "-", "-", result);
+    cout << line << flush;
+#endif
+    return passed;
+}
+
+//function to check every path of the engine against the reference engine: first on the sample database and batch that
+//come with the program, then on generated workloads of growing size (the seed and command mix of --generate apply;
+//each workload gets the next seed)
+//returns true if every path passed on every workload
+bool checkAgainstReference(const ProgramOptions& options)
+{
+    //(the smallest is big enough that the paths' fixed costs, like starting threads or sorting in temporary files, don't
+    //decide the timing)
+    static const uint64_t workloadRecords[]{ 2000, 8000, 20000 };
+    static const uint64_t workloadCommands[]{ 1000, 2000, 4000 };
+    const string database{ "reference-check.db" };
+    const string referenceDatabase{ "reference-check.ref.db" };
+    const string batchFile{ "reference-check.batch" };
+
+    //workloads written out as they are, rather than generated: db.txt and samplebatch.txt, then inputs at the edges of
+    //what the program handles (they are too small for the paths' times to mean anything, so only their output is checked)
+    struct FixedWorkload
+    {
+        const char* name;            //name the workload's lines are printed with
+        const char* database;        //contents of the database file
+        const char* batch;           //contents of the batch file
+        const char* expectedReport;  //report of a batch the reference can't run (nullptr: the reference's report)
+        const char* referenceDatabase;  //the database as the reference can read it (nullptr: the same database)
+    };
+    static const FixedWorkload fixedWorkloads[]{
+        { "sample",
+            "Pac-Man, 1000000, PAC, 300, $002499.7500\n"
+            "Spy Hunter, 700000, SPH, 50, $12.50\n"
+            "Zaxxon, 11525000, ZXN, 250, $62.50\n"
+            "Kangaroo, 199999900, ROO, 1000, $250.00\n",
+            "1 \"Donkey Kong\" 500000 JWS 25 $006.2500\n"
+            "2 Kong\n"
+            "3 \"Donkey Kong\" 3 9999\n"
+            "5 plays\n"
+            "5 name\n"
+            "1 \"Sekiro\" 507590 SCD 23 $226.2500\n",
+            nullptr, nullptr },
+        //sums past the range of a long long are reported as such, even when a partial sum passed it on the way
+        { "overflow",
+            "Big, 9000000000000000000, AA, 9000000000000000000, $1.00\n"
+            "Bigger, 9000000000000000000, BB, 9000000000000000000, $1.00\n"
+            "Small, 5, CC, -9000000000000000000, $1.00\n",
+            "6 sum plays\n"
+            "6 sum highscore\n"
+            "6 sum revenue\n",
+            "SUM OF plays: 9000000000000000000\n\n"
+            "SUM OF highscore: OUT OF RANGE\n\n"
+            "SUM OF revenue: $3.00\n\n",
+            nullptr },
+        //Windows line endings, with blank lines between the records (the reference can't skip blank lines)
+        { "crlf",
+            "Pac-Man, 1000000, PAC, 300, $002499.7500\r\n"
+            "\r\n"
+            "Spy Hunter, 700000, SPH, 50, $12.50\r\n"
+            "\r\n"
+            "\r\n"
+            "Zaxxon, 11525000, ZXN, 250, $62.50\r\n"
+            "\r\n",
+            "2 Pac-Man\n"
+            "5 plays\n"
+            "2 Zaxxon\n",
+            nullptr,
+            "Pac-Man, 1000000, PAC, 300, $002499.7500\r\n"
+            "Spy Hunter, 700000, SPH, 50, $12.50\r\n"
+            "Zaxxon, 11525000, ZXN, 250, $62.50\r\n" },
+    };
+
+    bool passed{ true };
+    char line[256];
+    cout << "REFERENCE CHECK: " << options.referenceWorkloads << " workloads, seed " << options.seed << '\n';
+    snprintf(line, sizeof(line), "%-9s %8s %9s  %-10s %10s %7s  %s\n", "workload", "records", "commands", "path", "ms", "ratio", "result");
+    cout << line;
+    for (const FixedWorkload& workload : fixedWorkloads)
+    {
+        ofstream databaseFile(database, ios::out | ios::binary);
+        databaseFile << workload.database;
+        databaseFile.close();
+        ofstream batch(batchFile, ios::out | ios::binary);
+        batch << workload.batch;
+        batch.close();
+        const char* readable{ workload.referenceDatabase != nullptr ? workload.referenceDatabase : workload.database };
+        ofstream referenceFile(referenceDatabase, ios::out | ios::binary);
+        referenceFile << readable;
+        referenceFile.close();
+        if (!databaseFile || !batch || !referenceFile)
+        {
+            cerr << "workload files could not be written.\n";
+            passed = false;
+            break;
+        }
+        passed = checkWorkload(workload.name, count(readable, readable + strlen(readable), '\n'),
+            count(workload.batch, workload.batch + strlen(workload.batch), '\n'), database, referenceDatabase, batchFile, false,
+            workload.expectedReport) && passed;
+    }
+
+    for (unsigned int workload{ 0 }; workload < options.referenceWorkloads; ++workload)
+    {
+        size_t size{ workload % (sizeof(workloadRecords) / sizeof(workloadRecords[0])) };
+        if (!generateWorkload(workloadRecords[size], workloadCommands[size], database, batchFile, options.commandMix, options.seed + workload))
+        {
+            passed = false;
+            break;
+        }
+        passed = checkWorkload(to_string(workload + 1), workloadRecords[size], workloadCommands[size], database, database, batchFile, true, nullptr) && passed;
+    }
+
+    remove(database.c_str());
+    remove(referenceDatabase.c_str());
+    remove(batchFile.c_str());
+    cout << (passed ? "REFERENCE CHECK PASSED\n" : "REFERENCE CHECK FAILED\n");
+    return passed;
+}
+
+//function to open a file to stream chunks of records from: a text database, or a file of snapshots
+//returns false (with an error printed) if the file can't be opened, or a database to stream is a snapshot
+bool openChunkReader(ChunkReader& reader, const string& filename, bool snapshots, size_t chunkBytes)
+{
+    reader.file.open(filename, ios::in | ios::binary);
+    reader.snapshots = snapshots;
+    reader.chunkBytes = chunkBytes;
+    if (!reader.file)
+    {
+        cerr << (snapshots ? "temporary file could not be opened for reading.\n" : "datafile could not be read.\n");
+        return false;
+    }
+
+    //a snapshot database is one large snapshot, which can't be read a part at a time
+    char magic[8]{};
+    reader.file.read(magic, sizeof(magic));
+    bool snapshotDatabase{ reader.file.gcount() == sizeof(magic) && memcmp(magic, "ARCADEDB", 8) == 0 };
+    reader.file.clear();
+    reader.file.seekg(0);
+    if (!snapshots && snapshotDatabase)
+    {
+        cerr << "datafile is a snapshot; only text databases can be streamed (convert it with --to-text).\n";
+        return false;
+    }
+    return true;
+}
+
+//function to load the next chunk of records into 'chunk' (appending to whatever it holds)
+//text is parsed a whole line at a time: a line cut off at the end of the chunk is kept for the next one
+//returns false once the file has nothing more to read
+bool readChunk(ChunkReader& reader, RecordList& chunk)
+{
+    if (!reader.snapshots)
+    {
+        //read until there is at least one whole line (or the file ends)
+        while (reader.file)
+        {
+            size_t kept{ reader.text.size() };
+            reader.text.resize(kept + reader.chunkBytes);
+            reader.file.read(&reader.text[kept], static_cast<streamsize>(reader.chunkBytes));
+            reader.text.resize(kept + static_cast<size_t>(reader.file.gcount()));
+            if (reader.text.find('\n', kept) != string::npos)
+            {
+                break;
+            }
+        }
+        if (reader.text.empty())
+        {
+            return false;
+        }
+        size_t end{ reader.file ? reader.text.rfind('\n') + 1 : reader.text.size() };
+        loadRecords(chunk, reader.text.data(), reader.text.data() + end);
+        reader.text.erase(0, end);
+        return true;
+    }
+
+    //snapshots are loaded one after another until the chunk is big enough
+    size_t bytes{ 0 };
+    bool loaded{ false };
+    while (bytes < reader.chunkBytes)
+    {
+        SnapshotHeader header;
+        if (!reader.file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        {
+            break;
+        }
+        uint64_t bodySize{ header.recordCount * sizeof(SnapshotRecord) + header.textCount * sizeof(SnapshotText) + header.heapSize };
+        vector<char>& copy = reader.snapshot.copy;
+        copy.resize(sizeof(header) + static_cast<size_t>(bodySize));
+        memcpy(copy.data(), &header, sizeof(header));
+        reader.file.read(copy.data() + sizeof(header), static_cast<streamsize>(bodySize));
+        reader.snapshot.data = copy.data();
+        reader.snapshot.size = copy.size();
+        if (static_cast<uint64_t>(reader.file.gcount()) != bodySize || !loadSnapshot(chunk, reader.snapshot))
+        {
+            reader.damaged = true;
+            return false;
+        }
+        bytes += copy.size();
+        loaded = true;
+    }
+    return loaded;
+}
+
+//function to get the name of a new temporary file for a streamed batch (it is removed once the batch is finished)
+string streamTempFile(StreamedBatch& stream)
+{
+    stream.tempFiles.push_back(stream.tempName + '.' + to_string(stream.tempFiles.size()));
+    return stream.tempFiles.back();
+}
+
+//function to write a chunk to a temporary file, as snapshots of up to streamBlockRecords records
+//(so a sorted run can be merged without reading all of it back at once)
+bool writeSnapshotBlocks(ofstream& file, const RecordList& chunk)
+{
+    SnapshotBuilder snapshot;
+    for (GameData* node = firstRecord(chunk); node != nullptr; node = nextRecord(chunk, node))
+    {
+        addSnapshotRecord(snapshot, *node);
+        if (snapshot.records.size() == streamBlockRecords)
+        {
+            writeSnapshot(file, snapshot);
+        }
+    }
+    if (!snapshot.records.empty())
+    {
+        writeSnapshot(file, snapshot);
+    }
+    return static_cast<bool>(file);
+}
+
+//function to keep the report text a command has just written (for the chunk being streamed) in the spill file
+void keepReportPiece(StreamedBatch& stream, size_t command)
+{
+    ReportSink& spill = stream.spill;
+    spill.file.write(spill.buffer.data(), static_cast<streamsize>(spill.buffer.size()));
+    spill.buffer.clear();
+    uint64_t end{ static_cast<uint64_t>(spill.file.tellp()) };
+    if (end > stream.spillSize)
+    {
+        stream.pieces.push_back(ReportPiece{ command, stream.spillSize, end - stream.spillSize });
+        stream.spillSize = end;
+    }
+}
+
+//function to run commands first to last-1 of a streamed batch (none of them sorts) over one chunk of records
+//each command runs on the chunk as it is, so the chunk ends up as it would after those commands on the whole list
+//an edit or delete whose record was found in an earlier chunk is skipped, and a command's report text is only kept
+//when the chunk had something for it; records are added only to the 'tail' (the chunk after the last database chunk)
+void streamChunk(StreamedBatch& stream, RecordList& chunk, size_t first, size_t last, bool tail)
+{
+    ReportSink& spill = stream.spill;
+    for (size_t index{ first }; index < last; ++index)
+    {
+        const BatchCommand& command = stream.batch->commands[index];
+        StreamedCommand& outcome = stream.commands[index];
+        spill.counts = ReportCounts{};
+        switch (command.type)
+        {
+        case CommandType::Add:
+            if (tail)
+            {
+                runAddCommand(chunk, spill, command);
+                keepReportPiece(stream, index);
+            }
+            break;
+        case CommandType::Search:
+            runSearchCommand(chunk, spill, command);
+            outcome.count += spill.counts.searchMatches;
+            if (spill.counts.searchMatches > 0)
+            {
+                keepReportPiece(stream, index);
+            }
+            break;
+        case CommandType::Edit:
+        case CommandType::Delete:
+            if (!outcome.found)
+            {
+                commandHandlers[static_cast<size_t>(command.type)](chunk, spill, command);
+                outcome.found = spill.counts.editsNotFound == 0 && spill.counts.deletesNotFound == 0;
+                outcome.count += spill.counts.edited + spill.counts.deleted;
+                if (outcome.found)
+                {
+                    keepReportPiece(stream, index);
+                }
+            }
+            break;
+        case CommandType::Reprice:
+        {
+            //the report has the total over every chunk, so it is printed once the whole database has been through;
+            //only the records left alone are reported chunk by chunk
+            bool found{ false };
+            outcome.count += repriceMatching(chunk, command.name, command.price, found);
+            outcome.found = outcome.found || found;
+            for (const GameData* node : chunk.repriceOverflows)
+            {
+                reportRepriceOverflow(spill, *node, command.price);
+            }
+            if (!chunk.repriceOverflows.empty())
+            {
+                keepReportPiece(stream, index);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        //text of commands that found nothing in this chunk (such as "Record to edit was not found.") is thrown away
+        spill.buffer.clear();
+    }
+}
+
+//function to merge sorted runs (temporary files) into one sorted file; records that sort the same keep the order of
+//the runs, so the merge is as stable as the sort itself
+//with 'listFor' set to a command's index, the merged records are listed as that sort command's report
+bool mergeRuns(StreamedBatch& stream, const vector<string>& runs, const string& output, const SortMethod& sortMethod, size_t listFor)
+{
+    //start each run at its first record (a block of it is read at a time)
+    vector<unique_ptr<MergeRun>> merging;
+    auto advance = [](MergeRun& run)
+    {
+        run.next = run.next != nullptr ? nextRecord(run.block, run.next) : nullptr;
+        while (run.next == nullptr)
+        {
+            freeAllRecords(run.block);
+            if (!readChunk(run.reader, run.block))
+            {
+                return;
+            }
+            run.next = firstRecord(run.block);
+        }
+    };
+    for (const string& name : runs)
+    {
+        merging.emplace_back(new MergeRun);
+        if (!openChunkReader(merging.back()->reader, name, true, 1))
+        {
+            return false;
+        }
+        advance(*merging.back());
+    }
+
+    //heap of runs, with the run whose next record comes first on top (an earlier run first, when records sort the same)
+    RecordOrder before{ recordOrderFor(sortMethod) };
+    auto later = [&merging, before](size_t a, size_t b)
+    {
+        const GameData& recordA = *merging[a]->next;
+        const GameData& recordB = *merging[b]->next;
+        return before(recordB, recordA) || (!before(recordA, recordB) && a > b);
+    };
+    priority_queue<size_t, vector<size_t>, decltype(later)> heap(later);
+    for (size_t run{ 0 }; run < merging.size(); ++run)
+    {
+        if (merging[run]->next != nullptr)
+        {
+            heap.push(run);
+        }
+    }
+
+    ofstream outputFile(output, ios::out | ios::binary | ios::trunc);
+    ReportSink& spill = stream.spill;
+    bool listing{ listFor != string::npos && !spill.quiet };
+    if (listing)
+    {
+        reportSortHeading(spill, sortMethod);
+    }
+    SnapshotBuilder snapshot;
+    while (!heap.empty() && outputFile)
+    {
+        size_t run{ heap.top() };
+        heap.pop();
+        const GameData& node = *merging[run]->next;
+        addSnapshotRecord(snapshot, node);
+        if (snapshot.records.size() == streamBlockRecords)
+        {
+            writeSnapshot(outputFile, snapshot);
+        }
+        if (listing)
+        {
+            appendRecordLine(spill.buffer, node);
+            if (spill.buffer.size() >= spill.flushSize)
+            {
+                flushReport(spill);
+            }
+        }
+        advance(*merging[run]);
+        if (merging[run]->next != nullptr)
+        {
+            heap.push(run);
+        }
+    }
+    if (!snapshot.records.empty())
+    {
+        writeSnapshot(outputFile, snapshot);
+    }
+    if (listing)
+    {
+        spill << '\n';
+        keepReportPiece(stream, listFor);
+    }
+
+    //runs are used up; give their disk space back straight away
+    bool merged{ static_cast<bool>(outputFile) };
+    outputFile.close();
+    for (size_t run{ 0 }; run < merging.size(); ++run)
+    {
+        merged = merged && !merging[run]->reader.damaged;
+        merging[run]->reader.file.close();
+        remove(runs[run].c_str());
+    }
+    if (!merged || !outputFile)
+    {
+        cerr << "temporary file could not be written or read back.\n";
+        return false;
+    }
+    return true;
+}
+
+//function to carry out a streamed batch's sort: merge the sorted runs the chunks were written to into 'output'
+//(in rounds when there are more runs than can be merged at once), listing the records as the sort's report
+bool mergeSortedRuns(StreamedBatch& stream, vector<string> runs, const string& output, size_t sortCommand)
+{
+    const SortMethod& sortMethod = stream.batch->commands[sortCommand].sortMethod;
+    while (runs.size() > maxMergeRuns)
+    {
+        //merge neighbouring runs together, so records that sort the same stay in order
+        vector<string> merged;
+        for (size_t start{ 0 }; start < runs.size(); start += maxMergeRuns)
+        {
+            vector<string> group(runs.begin() + static_cast<ptrdiff_t>(start), runs.begin() + static_cast<ptrdiff_t>(min(start + maxMergeRuns, runs.size())));
+            merged.push_back(streamTempFile(stream));
+            if (!mergeRuns(stream, group, merged.back(), sortMethod, string::npos))
+            {
+                return false;
+            }
+        }
+        runs = move(merged);
+    }
+    return mergeRuns(stream, runs, output, sortMethod, stream.commands[sortCommand].found ? sortCommand : string::npos);
+}
+
+//function to put a streamed batch's report together in batch order: each command's pieces from the spill file,
+//followed by what only the whole database could tell (not found, or a reprice's total)
+void finishStreamedReport(StreamedBatch& stream, ReportSink& report)
+{
+    ReportSink& spill = stream.spill;
+    spill.file.close();
+    ifstream spillFile(stream.tempName, ios::in | ios::binary);
+
+    //pieces were written chunk by chunk; a stable sort by command keeps each command's pieces in chunk order
+    stable_sort(stream.pieces.begin(), stream.pieces.end(), [](const ReportPiece& a, const ReportPiece& b) { return a.command < b.command; });
+
+    //commands that found nothing anywhere are run against an empty list, which gives exactly their report (and counts)
+    RecordList nothing;
+    string block;
+    size_t piece{ 0 };
+    for (size_t index{ 0 }; index < stream.commands.size(); ++index)
+    {
+        for (; piece < stream.pieces.size() && stream.pieces[piece].command == index; ++piece)
+        {
+            spillFile.seekg(static_cast<streamoff>(stream.pieces[piece].offset));
+            for (uint64_t left{ stream.pieces[piece].size }; left > 0 && spillFile; )
+            {
+                block.resize(static_cast<size_t>(min<uint64_t>(left, report.flushSize)));
+                spillFile.read(&block[0], static_cast<streamsize>(block.size()));
+                report << string_view(block);
+                left -= block.size();
+            }
+        }
+
+        const BatchCommand& command = stream.batch->commands[index];
+        const StreamedCommand& outcome = stream.commands[index];
+        switch (command.type)
+        {
+        case CommandType::Add:
+            ++report.counts.added;
+            break;
+        case CommandType::Search:
+            if (outcome.count == 0)
+            {
+                runSearchCommand(nothing, report, command);
+                break;
+            }
+            ++report.counts.searches;
+            report.counts.searchMatches += outcome.count;
+            break;
+        case CommandType::Edit:
+            if (!outcome.found)
+            {
+                runEditCommand(nothing, report, command);
+                break;
+            }
+            report.counts.edited += outcome.count;
+            break;
+        case CommandType::Delete:
+            if (!outcome.found)
+            {
+                runDeleteCommand(nothing, report, command);
+                break;
+            }
+            report.counts.deleted += outcome.count;
+            break;
+        case CommandType::Sort:
+            report.counts.sorts += outcome.found ? 1 : 0;
+            break;
+        case CommandType::Reprice:
+            if (!outcome.found)
+            {
+                runRepriceCommand(nothing, report, command);
+                break;
+            }
+            reportReprice(report, command.name, command.price, outcome.count);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+//function to run a batch over a text database that is streamed through it a chunk at a time, so memory use depends on
+//the chunk size (and the batch), not on the size of the database; reports and freeplay.dat come out exactly as when
+//the database is loaded whole
+//the batch is run in steps that end at its sorts: each chunk is run through a step's commands, then written out (records
+//added by the step come last, in a chunk of their own). A sort sorts each chunk into a run file and merges the runs
+//(an external merge sort); the next step streams the merged file. The last step writes freeplay.dat
+//returns false if a file can't be read or written, or the batch can't be streamed
+bool streamBatch(const string& database, const Batch& batch, ReportSink& report, const ProgramOptions& options)
+{
+    if (options.journal || options.readerThreads > 0 || options.stats || options.benchmark)
+    {
+        cerr << "--stream can't be combined with --journal, --readers, --benchmark or --stats.\n";
+        return false;
+    }
+    for (const BatchCommand& command : batch.commands)
+    {
+        if (command.type == CommandType::Aggregate || command.type == CommandType::Range)
+        {
+            cerr << "batchfile line " << command.lineNumber << ": aggregate and range commands need the whole database in memory; run without --stream.\n";
+            return false;
+        }
+    }
+
+    StreamedBatch stream;
+    stream.batch = &batch;
+    stream.commands.resize(batch.commands.size());
+    stream.tempName = "freeplay.dat.stream";
+    stream.spill.quiet = report.quiet;
+    if (!openReportFile(stream.spill, stream.tempName))
+    {
+        cerr << "temporary file could not be opened for writing.\n";
+        return false;
+    }
+    ChunkReader input;
+    string inputName;  //temporary file the step streams (empty while it is the database)
+    if (!openChunkReader(input, database, false, options.streamBytes))
+    {
+        stream.spill.file.close();
+        remove(stream.tempName.c_str());
+        return false;
+    }
+
+    bool streamed{ true };
+    size_t first{ 0 };
+    RecordList chunk;
+    ReportSink unreported;  //report of sorting a single chunk (only the merged sort is reported)
+    unreported.quiet = true;
+    for (;;)
+    {
+        //this step runs the commands up to the next sort (or the end of the batch)
+        size_t last{ first };
+        while (last < batch.commands.size() && batch.commands[last].type != CommandType::Sort)
+        {
+            ++last;
+        }
+        bool finalStep{ last == batch.commands.size() };
+        const SortMethod* sortMethod = finalStep ? nullptr : &batch.commands[last].sortMethod;
+
+        //the last step writes freeplay.dat (a temporary file next to it with --atomic-write); a step ending in a sort
+        //writes each chunk to a run of its own, sorted (or, when the sort doesn't reorder anything, all to one file)
+        string target{ options.atomicWrite ? string("freeplay.dat.tmp") : string("freeplay.dat") };
+        ofstream output;
+        vector<string> runs;
+        if (finalStep)
+        {
+            output.open(target, ios::out);
+        }
+        else if (!sortMethod->known)
+        {
+            runs.push_back(streamTempFile(stream));
+            output.open(runs.back(), ios::out | ios::binary | ios::trunc);
+        }
+        if ((finalStep || !sortMethod->known) && !output)
+        {
+            cerr << (finalStep ? "Error: datafile could not be opened for writing.\n" : "temporary file could not be opened for writing.\n");
+            streamed = false;
+            break;
+        }
+
+        size_t records{ 0 };
+        auto passChunk = [&](bool tail)
+        {
+            streamChunk(stream, chunk, first, last, tail);
+            records += chunk.size;
+            if (finalStep)
+            {
+                printList(output, chunk);
+            }
+            else if (!sortMethod->known)
+            {
+                writeSnapshotBlocks(output, chunk);
+            }
+            else if (chunk.size > 0)
+            {
+                sortRecords(chunk, unreported, *sortMethod);
+                runs.push_back(streamTempFile(stream));
+                ofstream run(runs.back(), ios::out | ios::binary | ios::trunc);
+                streamed = writeSnapshotBlocks(run, chunk) && streamed;
+            }
+            freeAllRecords(chunk);
+        };
+        while (readChunk(input, chunk))
+        {
+            passChunk(false);
+        }
+        passChunk(true);
+        streamed = streamed && !input.damaged && !output.fail();
+        input.file.close();
+        output.close();
+        if (!inputName.empty())
+        {
+            remove(inputName.c_str());
+        }
+        if (!streamed)
+        {
+            cerr << (finalStep ? "Error: datafile could not be written.\n" : "temporary file could not be written or read back.\n");
+            break;
+        }
+
+        if (finalStep)
+        {
+            //move finished temporary file over the real one (only once its contents are safely on disk)
+            if (options.atomicWrite && (!syncFile(target) || rename(target.c_str(), "freeplay.dat") != 0))
+            {
+                cerr << "Error: datafile could not be replaced.\n";
+                remove(target.c_str());
+                streamed = false;
+            }
+            break;
+        }
+
+        //the sort: a list of fewer than two records isn't sorted (or reported), just as when it is loaded whole
+        stream.commands[last].found = records >= 2;
+        inputName = streamTempFile(stream);
+        if (!mergeSortedRuns(stream, runs, inputName, last) || !openChunkReader(input, inputName, true, options.streamBytes))
+        {
+            streamed = false;
+            break;
+        }
+        first = last + 1;
+    }
+
+    if (streamed)
+    {
+        finishStreamedReport(stream, report);
+    }
+    stream.spill.file.close();
+    remove(stream.tempName.c_str());
+    for (const string& name : stream.tempFiles)
+    {
+        remove(name.c_str());
+    }
+    return streamed;
+}
+
+//function to pick the shard a game belongs to, from the top bits of the hash of its name (ignoring case), so every
+//record a command can name is on the same shard; the name index uses the low bits, which stay evenly spread in a shard
+size_t shardFor(string_view name, size_t shards)
+{
+    size_t topBits{ hashNameIgnoreCase(name) >> (sizeof(size_t) * 8 - 16) };
+    return topBits * shards >> 16;
+}
+
+//function to check whether a command has to run on every shard (searches, and reprices of every game), rather than
+//only on the shard of the game it names
+bool runsOnEveryShard(const BatchCommand& command)
+{
+    return command.type == CommandType::Search || (command.type == CommandType::Reprice && command.name.empty());
+}
+
+//function to check that a batch can be run with its records split into shards, printing why not if it can't
+bool canShardBatch(const Batch& batch, const ProgramOptions& options)
+{
+    if (options.readerThreads > 0 || options.streamBytes > 0 || options.benchmark || options.stats || options.stressSeconds > 0)
+    {
+        cerr << "--shards can't be combined with --readers, --stream, --benchmark, --stats or --stress-readers.\n";
+        return false;
+    }
+    for (const BatchCommand& command : batch.commands)
+    {
+        if (command.type == CommandType::Aggregate || command.type == CommandType::Range)
+        {
+            cerr << "aggregate and range commands need every shard's records at once; run without --shards.\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+//function to deal the list's records out to the shards by name, numbering them in list order (the list is left empty)
+void splitIntoShards(RecordList& list, vector<Shard>& shards)
+{
+    unsigned int sequence{ 0 };
+    for (GameData* node = firstRecord(list); node != nullptr; node = nextRecord(list, node))
+    {
+        copyRecord(shards[shardFor(node->name.view(), shards.size())].list, *node)->sequence = sequence++;
+    }
+    freeAllRecords(list);
+}
+
+//function to put the shards' records back into the list, in sequence order (the shards are left empty)
+void gatherShards(RecordList& list, vector<Shard>& shards)
+{
+    vector<GameData*> heads;
+    for (Shard& shard : shards)
+    {
+        heads.push_back(firstRecord(shard.list));
+    }
+    while (true)
+    {
+        size_t first{ heads.size() };
+        for (size_t s{ 0 }; s < heads.size(); ++s)
+        {
+            if (heads[s] != nullptr && (first == heads.size() || heads[s]->sequence < heads[first]->sequence))
+            {
+                first = s;
+            }
+        }
+        if (first == heads.size())
+        {
+            break;
+        }
+        copyRecord(list, *heads[first]);
+        heads[first] = nextRecord(shards[first].list, heads[first]);
+    }
+    for (Shard& shard : shards)
+    {
+        freeAllRecords(shard.list);
+    }
+}
+
+//function to run the shard's commands of the current window in order, keeping the report text of each apart
+//(runs on the shard's own thread, and touches nothing but the shard)
+void runShardCommands(Shard& shard, const Batch& batch)
+{
+    for (size_t i{ 0 }; i < shard.commands.size(); ++i)
+    {
+        const BatchCommand& command = batch.commands[shard.commands[i]];
+        size_t begin{ shard.report.buffer.size() };
+        if (command.type == CommandType::Search)
+        {
+            //every record found is a piece of its own, to be merged with the other shards' in list order
+            toLowercase(command.name, shard.list.searchTerm);
+            findNamesContaining(shard.list, shard.list.searchTerm, shard.list.searchMatches);
+            for (GameData* node : shard.list.searchMatches)
+            {
+                reportFoundRecord(shard.report, *node);
+                shard.pieces.push_back(ShardPiece{ begin, shard.report.buffer.size(), node->sequence });
+                begin = shard.report.buffer.size();
+            }
+        }
+        else if (runsOnEveryShard(command))
+        {
+            //each record left alone is a piece of its own, like a search's; the number of records changed is kept, and
+            //the reprice is reported once, for every shard together
+            bool found{ false };
+            shard.repriced.push_back(repriceMatching(shard.list, command.name, command.price, found));
+            for (const GameData* node : shard.list.repriceOverflows)
+            {
+                reportRepriceOverflow(shard.report, *node, command.price);
+                shard.pieces.push_back(ShardPiece{ begin, shard.report.buffer.size(), node->sequence });
+                begin = shard.report.buffer.size();
+            }
+        }
+        else
+        {
+            commandHandlers[static_cast<size_t>(command.type)](shard.list, shard.report, command);
+            if (command.type == CommandType::Add)
+            {
+                lastRecord(shard.list)->sequence = shard.sequences[i];
+            }
+            shard.pieces.push_back(ShardPiece{ begin, shard.report.buffer.size(), 0 });
+        }
+        shard.pieceEnds.push_back(shard.pieces.size());
+    }
+}
+
+//function to put the reports of the window's commands (batch positions 'first' to 'last'-1) into the run's report,
+//in batch order; a search's records are merged from every shard by sequence number, which is list order
+void collectShardReports(vector<Shard>& shards, ReportSink& report, const Batch& batch, size_t first, size_t last)
+{
+    vector<size_t> nextCommand(shards.size(), 0);  //next of each shard's commands to collect
+    vector<size_t> nextPiece(shards.size(), 0);    //next of each shard's pieces to collect
+    size_t reprices{ 0 };                          //reprices of every game collected so far
+    auto pieceText = [&shards](size_t s, size_t piece)
+    {
+        const ShardPiece& text = shards[s].pieces[piece];
+        return string_view(shards[s].report.buffer).substr(text.begin, text.end - text.begin);
+    };
+
+    //function to print the current command's pieces from every shard, taking the piece with the lowest sequence number
+    //until none has any left; returns how many were printed
+    auto mergePieces = [&]()
+    {
+        size_t merged{ 0 };
+        while (true)
+        {
+            size_t from{ shards.size() };
+            for (size_t s{ 0 }; s < shards.size(); ++s)
+            {
+                if (nextPiece[s] < shards[s].pieceEnds[nextCommand[s]]
+                    && (from == shards.size() || shards[s].pieces[nextPiece[s]].sequence < shards[from].pieces[nextPiece[from]].sequence))
+                {
+                    from = s;
+                }
+            }
+            if (from == shards.size())
+            {
+                return merged;
+            }
+            report << pieceText(from, nextPiece[from]++);
+            ++merged;
+        }
+    };
+
+    for (size_t position{ first }; position < last; ++position)
+    {
+        const BatchCommand& command = batch.commands[position];
+        if (!runsOnEveryShard(command))
+        {
+            size_t s{ shardFor(command.name, shards.size()) };
+            for (; nextPiece[s] < shards[s].pieceEnds[nextCommand[s]]; ++nextPiece[s])
+            {
+                report << pieceText(s, nextPiece[s]);
+            }
+            ++nextCommand[s];
+            continue;
+        }
+
+        if (command.type == CommandType::Search)
+        {
+            ++report.counts.searches;
+            size_t found{ mergePieces() };
+            if (found == 0)
+            {
+                ++report.counts.searchesNotFound;
+                report << command.name << " NOT FOUND\n";
+            }
+        }
+        else
+        {
+            mergePieces();
+            size_t changed{ 0 };
+            for (Shard& shard : shards)
+            {
+                changed += shard.repriced[reprices];
+            }
+            ++reprices;
+            reportReprice(report, command.name, command.price, changed);
+        }
+        for (size_t& next : nextCommand)
+        {
+            ++next;
+        }
+    }
+}
+
+//function to run a sort: every shard sorts its own records, on its own thread, then the shards are merged (by the sort's
+//order, then by sequence number, which keeps the sort stable) to print the records and number them in their new order
+void sortShards(vector<Shard>& shards, ReportSink& report, const SortMethod& sortMethod)
+{
+    //as with one list, a list of fewer than two records is left alone, and nothing is printed
+    size_t size{ 0 };
+    for (const Shard& shard : shards)
+    {
+        size += shard.list.size;
+    }
+    if (size < 2)
+    {
+        return;
+    }
+
+    vector<thread> sorters;
+    for (Shard& shard : shards)
+    {
+        sorters.emplace_back([&shard, &sortMethod]()
+            {
+                ReportSink unprinted;
+                unprinted.quiet = true;
+                sortRecords(shard.list, unprinted, sortMethod);
+            });
+    }
+    for (thread& sorter : sorters)
+    {
+        sorter.join();
+    }
+
+    ++report.counts.sorts;
+    if (!report.quiet)
+    {
+        reportSortHeading(report, sortMethod);
+    }
+    RecordOrder before{ recordOrderFor(sortMethod) };
+    vector<GameData*> heads;
+    for (Shard& shard : shards)
+    {
+        heads.push_back(firstRecord(shard.list));
+    }
+    for (unsigned int sequence{ 0 }; sequence < size; ++sequence)
+    {
+        size_t first{ heads.size() };
+        for (size_t s{ 0 }; s < heads.size(); ++s)
+        {
+            if (heads[s] != nullptr && (first == heads.size() || before(*heads[s], *heads[first])
+                || (!before(*heads[first], *heads[s]) && heads[s]->sequence < heads[first]->sequence)))
+            {
+                first = s;
+            }
+        }
+        GameData* node = heads[first];
+        heads[first] = nextRecord(shards[first].list, node);
+        node->sequence = sequence;
+        if (!report.quiet)
+        {
+            appendRecordLine(report.buffer, *node);
+            if (report.buffer.size() >= report.flushSize && !report.hold)
+            {
+                flushReport(report);
+            }
+        }
+    }
+    report << '\n';
+}
+
+//function to run a parsed batch with the records split into shards by name (--shards), each run by its own thread
+//adds, edits, deletes and reprices of one game run only on the shard of the game they name, in batch order; searches
+//and reprices of every game run on every shard, each shard answering at its own place in its commands, so no shard
+//waits for another; only sorts wait for every shard, since the sorted records have to be merged
+//the shards' reports are put back in batch order every shardWindow commands, so the reports and the records left at
+//the end are exactly what runBatch would have produced (aggregates and ranges are refused by canShardBatch)
+void runShardedBatch(RecordList& list, ReportSink& report, Journal& journal, const Batch& batch, unsigned int shardCount)
+{
+    if (shardCount == 0)
+    {
+        shardCount = min(thread::hardware_concurrency() > 0 ? thread::hardware_concurrency() : 1, maxShards);
+    }
+    vector<Shard> shards(shardCount);
+    for (Shard& shard : shards)
+    {
+#ifndef ARCADE_CONTIGUOUS_STORE
+        shard.list.pool.useHeap = list.pool.useHeap;
+#endif
+        shard.report.quiet = report.quiet;
+        shard.report.hold = true;
+    }
+    unsigned int nextSequence{ static_cast<unsigned int>(list.size) };
+    splitIntoShards(list, shards);
+
+    size_t first{ 0 };
+    while (first < batch.commands.size())
+    {
+        if (batch.commands[first].type == CommandType::Sort)
+        {
+            if (journal.enabled)
+            {
+                journalCommand(journal, batch.commands[first].line);
+            }
+            sortShards(shards, report, batch.commands[first].sortMethod);
+            ++first;
+            continue;
+        }
+
+        //deal the commands up to the next sort (at most shardWindow of them) out to the shards they run on
+        size_t last{ first };
+        for (; last < batch.commands.size() && last - first < shardWindow && batch.commands[last].type != CommandType::Sort; ++last)
+        {
+            const BatchCommand& command = batch.commands[last];
+            if (journal.enabled && changesRecords(command.type))
+            {
+                journalCommand(journal, command.line);
+            }
+            if (runsOnEveryShard(command))
+            {
+                for (Shard& shard : shards)
+                {
+                    shard.commands.push_back(last);
+                    shard.sequences.push_back(0);
+                }
+            }
+            else
+            {
+                Shard& shard = shards[shardFor(command.name, shards.size())];
+                shard.commands.push_back(last);
+                shard.sequences.push_back(command.type == CommandType::Add ? nextSequence++ : 0);
+            }
+        }
+
+        vector<thread> workers;
+        for (Shard& shard : shards)
+        {
+            workers.emplace_back(runShardCommands, ref(shard), cref(batch));
+        }
+        for (thread& worker : workers)
+        {
+            worker.join();
+        }
+        collectShardReports(shards, report, batch, first, last);
+        for (Shard& shard : shards)
+        {
+            shard.commands.clear();
+            shard.sequences.clear();
+            shard.pieceEnds.clear();
+            shard.pieces.clear();
+            shard.repriced.clear();
+            shard.report.buffer.clear();
+        }
+        first = last;
+    }
+
+    for (Shard& shard : shards)
+    {
+        addCounts(report.counts, shard.report.counts);
+    }
+    gatherShards(list, shards);
+}
+
+//function to save the server's records: with a journal, the journal is folded into a new database file; otherwise
+//the records are written to freeplay.dat, as at the end of a batch run
+//returns false (after printing why) if they could not be saved
+bool saveServedDatabase(ServedDatabase& served, const ProgramOptions& options)
+{
+    chrono::steady_clock::time_point writeStart{ chrono::steady_clock::now() };
+    bool written{ false };
+    if (served.journal.enabled)
+    {
+        written = compactDatabase(served.list, served.journal, served.filename, served.format);
+        if (!written)
+        {
+            cerr << "database could not be compacted (its journal still holds every change).\n";
+        }
+    }
+    else
+    {
+        written = writeRecordsToFile(served.list, "freeplay.dat", options.atomicWrite, DatabaseFormat::Text);
+    }
+    if (written)
+    {
+        served.changed = false;
+        served.saved = true;
+        served.savedAt = chrono::steady_clock::now();
+        served.stats.writtenRecords = served.list.size;
+        served.stats.writeNanoseconds = nanosecondsSince(writeStart);
+    }
+    return written;
+}
+
+//function to run one batch sent to the server against its records, sending the reports to 'out'
+//with a journal, the batch's changes are committed once it has run (and the database compacted once the journal is big
+//enough), just as at the end of a batch run; without one, the records are saved if --save-every says it is time
+//returns false if the batch's changes could not be made permanent (the server then stops)
+bool serveBatch(ServedDatabase& served, const ProgramOptions& options, Batch& batch, ostream& out)
+{
+    if (options.strictBatch && batch.errorCount > 0)
+    {
+        out << "batchfile has " << batch.errorCount << " invalid line(s); nothing was run.\n";
+        return true;
+    }
+
+    ReportSink report;
+    report.stream = &out;
+    report.quiet = options.quiet;
+    runBatch(served.list, report, served.journal, batch, options.readerThreads, served.stats);
+    if (report.quiet)
+    {
+        printReportSummary(report);
+    }
+    flushReport(report);
+    addCounts(served.counts, report.counts);
+    for (const BatchCommand& command : batch.commands)
+    {
+        served.changed = served.changed || changesRecords(command.type);
+    }
+
+    if (served.journal.enabled)
+    {
+        if (!commitJournal(served.journal))
+        {
+            out << "journal could not be written.\n";
+            return false;
+        }
+        if (served.journal.size > served.journal.baseSize / 2 && !compactDatabase(served.list, served.journal, served.filename, served.format))
+        {
+            out << "database could not be compacted (its journal still holds every change).\n";
+            return false;
+        }
+    }
+    if (served.changed && options.saveSeconds >= 0
+        && chrono::duration<double>(chrono::steady_clock::now() - served.savedAt).count() >= options.saveSeconds)
+    {
+        if (!saveServedDatabase(served, options))
+        {
+            out << "database could not be saved.\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+//function to answer the requests of one client until it quits (or its input ends), one request per line:
+//  batch FILE      run a batch file
+//  <command line>  run the command lines from here up to a line holding only "." as one batch
+//  save            save the records now
+//  quit            end this client's requests (stdin has only the one client, so the server stops too)
+//  shutdown        stop the server
+//each response ends with a line holding only "." (a line no report ever consists of)
+//returns false if the server has to stop because the records could not be saved; 'stop' is set by shutdown
+bool serveRequests(ServedDatabase& served, const ProgramOptions& options, istream& in, ostream& out, bool& stop)
+{
+    string line;
+    while (getline(in, line))
+    {
+        //clients on a terminal or socket may end lines with "\r\n"
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (line.empty())
+        {
+            continue;
+        }
+
+        bool kept{ true };
+        if (line.rfind("batch ", 0) == 0)
+        {
+            Batch batch;
+            if (!mapFile(line.substr(6), batch.file))
+            {
+                out << "batchfile could not be opened for reading.\n";
+            }
+            else
+            {
+                parseBatch(batch, out);
+                kept = serveBatch(served, options, batch, out);
+            }
+        }
+        else if (line[0] >= '1' && line[0] <= '9')
+        {
+            //collect the command stream into the batch's own copy of its "file", which its commands point into
+            string text{ line + '\n' };
+            while (getline(in, line))
+            {
+                if (!line.empty() && line.back() == '\r')
+                {
+                    line.pop_back();
+                }
+                if (line == ".")
+                {
+                    break;
+                }
+                text += line + '\n';
+            }
+            Batch batch;
+            batch.file.copy.assign(text.begin(), text.end());
+            batch.file.data = batch.file.copy.data();
+            batch.file.size = batch.file.copy.size();
+            parseBatch(batch, out);
+            kept = serveBatch(served, options, batch, out);
+        }
+        else if (line == "save")
+        {
+            kept = saveServedDatabase(served, options);
+            out << (kept ? "DATABASE SAVED (" + to_string(served.list.size) + " records)\n" : string("database could not be saved.\n"));
+        }
+        else if (line == "quit" || line == "shutdown")
+        {
+            stop = stop || line == "shutdown";
+            out << ".\n" << flush;
+            return true;
+        }
+        else
+        {
+            out << "unknown request: " << line << '\n';
+        }
+        out << ".\n" << flush;
+        if (!kept)
+        {
+            stop = true;
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifndef _WIN32
+//functions of the stream buffer over a client's socket: read a block when everything read has been taken,
+//and write everything given (carrying on after interrupted calls)
+int DescriptorBuffer::underflow()
+{
+    ssize_t got{ 0 };
+    do
+    {
+        got = read(descriptor, input, sizeof(input));
+    } while (got < 0 && errno == EINTR);
+    if (got <= 0)
+    {
+        return traits_type::eof();
+    }
+    setg(input, input, input + got);
+    return traits_type::to_int_type(input[0]);
+}
+
+int DescriptorBuffer::overflow(int character)
+{
+    if (traits_type::eq_int_type(character, traits_type::eof()))
+    {
+        return traits_type::not_eof(character);
+    }
+    char byte{ traits_type::to_char_type(character) };
+    return xsputn(&byte, 1) == 1 ? character : traits_type::eof();
+}
+
+streamsize DescriptorBuffer::xsputn(const char* data, streamsize size)
+{
+    streamsize written{ 0 };
+    while (written < size)
+    {
+        ssize_t put{ write(descriptor, data + written, static_cast<size_t>(size - written)) };
+        if (put < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (put <= 0)
+        {
+            break;
+        }
+        written += put;
+    }
+    return written;
+}
+
+//function to start listening for clients on a Unix socket at 'path' (a socket left behind by an earlier server is
+//replaced; anything else at the path is left alone)
+//returns the listening socket, or -1 (after printing why) if it could not be set up
+int listenOnSocket(const string& path)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        cerr << "socket path is too long: " << path << '\n';
+        return -1;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    struct stat existing;
+    if (lstat(path.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode))
+    {
+        unlink(path.c_str());
+    }
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 || bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 16) != 0)
+    {
+        cerr << "socket could not be opened: " << path << '\n';
+        if (listener >= 0)
+        {
+            close(listener);
+        }
+        return -1;
+    }
+    return listener;
+}
+#endif
+
+//function to run the server: load the database once, then answer requests from stdin, or from one client after
+//another on a Unix socket, until told to stop; the records are saved at the end if they changed since the last save
+//returns false if the database could not be loaded or saved
+bool runServer(const string& database, const ProgramOptions& options)
+{
+    if (options.streamBytes > 0 || options.benchmark || options.stressSeconds > 0 || !options.reportFile.empty() || options.shards != 1)
+    {
+        cerr << "--serve can't be combined with --stream, --benchmark, --stress-readers, --report or --shards.\n";
+        return false;
+    }
+#ifdef _WIN32
+    if (!options.serveSocket.empty())
+    {
+        cerr << "Unix sockets are not available on this system; use --serve without a socket.\n";
+        return false;
+    }
+#endif
+
+    //the database file is created if it does not exist, as for a batch run
+    {
+        fstream datfile(database, ios::in | ios::out | ios::binary | ios::app);
+        if (!datfile)
+        {
+            cerr << "datafile could not be opened for reading.\n";
+            return false;
+        }
+    }
+
+    ServedDatabase served;
+    served.filename = database;
+#ifndef ARCADE_CONTIGUOUS_STORE
+    served.list.pool.useHeap = options.heapNodes;
+#endif
+    served.list.columns.check = options.checkAggregates;
+#ifndef ARCADE_NO_STATS
+    served.stats.enabled = options.stats;
+#endif
+    chrono::steady_clock::time_point loadStart{ chrono::steady_clock::now() };
+    if (!createLinkedList(served.list, database, options.loadThreads, served.format))
+    {
+        cerr << "datafile could not be read.\n";
+        return false;
+    }
+    if (options.journal && !openJournal(served.journal, served.list, database))
+    {
+        return false;
+    }
+    served.stats.loadedRecords = served.list.size;
+    served.stats.loadNanoseconds = nanosecondsSince(loadStart);
+    served.savedAt = chrono::steady_clock::now();
+
+    bool running{ true };
+    bool stop{ false };
+    if (options.serveSocket.empty())
+    {
+        running = serveRequests(served, options, cin, cout, stop);
+    }
+#ifndef _WIN32
+    else
+    {
+        int listener{ listenOnSocket(options.serveSocket) };
+        if (listener < 0)
+        {
+            freeAllRecords(served.list);
+            return false;
+        }
+        //a client that goes away mid-response must not kill the server
+        signal(SIGPIPE, SIG_IGN);
+        cout << "SERVING " << served.list.size << " RECORDS ON " << options.serveSocket << '\n' << flush;
+        while (running && !stop)
+        {
+            int client = accept(listener, nullptr, nullptr);
+            if (client < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                break;
+            }
+            DescriptorBuffer buffer(client);
+            istream in(&buffer);
+            ostream out(&buffer);
+            running = serveRequests(served, options, in, out, stop);
+            close(client);
+        }
+        close(listener);
+        unlink(options.serveSocket.c_str());
+    }
+#endif
+
+    //save what the last batches changed (or, if nothing was ever saved, write freeplay.dat as a batch run would)
+    bool saved{ running };
+    if (running && (served.changed || (!served.saved && !served.journal.enabled)))
+    {
+        saved = saveServedDatabase(served, options);
+    }
+    if (served.stats.enabled)
+    {
+        reportStats(options, served.stats, served.counts);
+    }
+    freeAllRecords(served.list);
+    return saved && served.list.columns.mismatches == 0;
+}
+
+//checksum of a journal entry (FNV-1a), so an entry that was only partly written before a crash is noticed
+uint32_t journalChecksum(string_view data)
+{
+    uint32_t checksum{ 2166136261u };
+    for (char character : data)
+    {
+        checksum ^= static_cast<unsigned char>(character);
+        checksum *= 16777619u;
+    }
+    return checksum;
+}
+
+//function to make the header of a journal for a database file, identifying the file as it is now
+JournalHeader journalHeaderFor(const string& database)
+{
+    JournalHeader header{};
+    memcpy(header.magic, "ARCADEJL", 8);
+    header.version = journalVersion;
+#ifndef _WIN32
+    struct stat status;
+    if (stat(database.c_str(), &status) == 0)
+    {
+        header.baseSize = static_cast<uint64_t>(status.st_size);
+        header.baseModified = static_cast<uint64_t>(status.st_mtime);
+        header.baseFileId = static_cast<uint64_t>(status.st_ino);
+    }
+#else
+    ifstream input(database, ios::in | ios::binary | ios::ate);
+    header.baseSize = input ? static_cast<uint64_t>(input.tellg()) : 0;
+#endif
+    return header;
+}
+
+//function to check whether two journal headers identify the same database file
+bool sameBase(const JournalHeader& a, const JournalHeader& b)
+{
+    return a.baseSize == b.baseSize && a.baseModified == b.baseModified && a.baseFileId == b.baseFileId;
+}
+
+//function to (re)write a whole journal file: written to a temporary file first and renamed into place,
+//so the journal is never seen half written
+bool writeJournalFile(const string& filename, const JournalHeader& header, string_view entries)
+{
+    string target{ filename + ".tmp" };
+    ofstream output(target, ios::out | ios::binary | ios::trunc);
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output.write(entries.data(), static_cast<streamsize>(entries.size()));
+    output.close();
+    if (!output || !syncFile(target) || rename(target.c_str(), filename.c_str()) != 0)
+    {
+        remove(target.c_str());
+        return false;
+    }
+    return true;
+}
+
+//function to start journaling changes to a database whose records have just been loaded into the list
+//the commands already in the database's journal are run again first (silently), bringing the list up to date;
+//an entry cut short by a crash ends the journal there, and is dropped
+//returns false (with an explanation on cerr) if the journal cannot be used
+bool openJournal(Journal& journal, RecordList& list, const string& database)
+{
+    journal.filename = database + ".journal";
+    JournalHeader header{ journalHeaderFor(database) };
+    journal.baseSize = header.baseSize;
+
+    MappedFile existing;
+    size_t validSize{ 0 };
+    bool rewrite{ true };
+    if (mapFile(journal.filename, existing) && existing.size > 0)
+    {
+        JournalHeader existingHeader;
+        if (existing.size < sizeof(existingHeader) || memcmp(existing.data, "ARCADEJL", 8) != 0)
+        {
+            cerr << "journal " << journal.filename << " is not a journal file.\n";
+            return false;
+        }
+        memcpy(&existingHeader, existing.data, sizeof(existingHeader));
+        if (existingHeader.version != journalVersion)
+        {
+            cerr << "journal " << journal.filename << " has unsupported version " << existingHeader.version << ".\n";
+            return false;
+        }
+
+        //a journal for an earlier version of the database file (the file was replaced after the journal was written,
+        //e.g. by a compaction that was interrupted before it could start a new journal) must not be applied to it
+        if (!sameBase(header, existingHeader))
+        {
+            string stale{ journal.filename + ".stale" };
+            cerr << "journal " << journal.filename << " belongs to an earlier version of " << database
+                << "; it was moved to " << stale << " and not applied.\n";
+            rename(journal.filename.c_str(), stale.c_str());
+        }
+        else
+        {
+            //run each complete entry's command again, without printing any reports
+            ReportSink silent;
+            silent.quiet = true;
+            string error;
+            validSize = sizeof(JournalHeader);
+            while (existing.size - validSize >= 8)
+            {
+                uint32_t entrySize;
+                uint32_t checksum;
+                memcpy(&entrySize, existing.data + validSize, 4);
+                memcpy(&checksum, existing.data + validSize + 4, 4);
+                if (entrySize > existing.size - validSize - 8)
+                {
+                    break;
+                }
+                string_view line(existing.data + validSize + 8, entrySize);
+                BatchCommand command;
+                if (journalChecksum(line) != checksum || !parseCommand(line, command, error))
+                {
+                    break;
+                }
+                commandHandlers[static_cast<size_t>(command.type)](list, silent, command);
+                validSize += 8 + entrySize;
+            }
+            rewrite = validSize != existing.size;
+            if (rewrite)
+            {
+                cerr << "journal " << journal.filename << " ended with an incomplete entry, which was dropped.\n";
+            }
+        }
+    }
+
+    //start a new journal (or cut off the damaged end of this one)
+    if (rewrite)
+    {
+        string_view entries{ validSize > 0 ? string_view(existing.data + sizeof(JournalHeader), validSize - sizeof(JournalHeader)) : string_view() };
+        if (!writeJournalFile(journal.filename, header, entries))
+        {
+            cerr << "journal " << journal.filename << " could not be written.\n";
+            return false;
+        }
+        validSize = sizeof(JournalHeader) + entries.size();
+    }
+
+    journal.file.open(journal.filename, ios::out | ios::binary | ios::app);
+    if (!journal.file)
+    {
+        cerr << "journal " << journal.filename << " could not be opened for writing.\n";
+        return false;
+    }
+    journal.size = validSize;
+    journal.enabled = true;
+    return true;
+}
+
+//function to add a command (its batch file line) to the journal; it is written out by commitJournal
+void journalCommand(Journal& journal, string_view line)
+{
+    uint32_t entrySize{ static_cast<uint32_t>(line.size()) };
+    uint32_t checksum{ journalChecksum(line) };
+    journal.buffer.append(reinterpret_cast<const char*>(&entrySize), 4);
+    journal.buffer.append(reinterpret_cast<const char*>(&checksum), 4);
+    journal.buffer.append(line);
+    journal.size += 8 + line.size();
+
+    //keep memory use down during large batches (the entries only become permanent at the commit)
+    if (journal.buffer.size() >= (1 << 20))
+    {
+        journal.file.write(journal.buffer.data(), static_cast<streamsize>(journal.buffer.size()));
+        journal.buffer.clear();
+    }
+}
+
+//function to make every journaled command permanent: the entries are written out and forced to disk
+//costs time in proportion to the commands journaled since the last commit, not to the size of the database
+bool commitJournal(Journal& journal)
+{
+    journal.file.write(journal.buffer.data(), static_cast<streamsize>(journal.buffer.size()));
+    journal.buffer.clear();
+    journal.file.flush();
+    return static_cast<bool>(journal.file) && syncFile(journal.filename);
+}
+
+//function to fold the journal into the database: the whole list is written to a new database file (in the same
+//format as before) that replaces the old one, then the journal starts again empty for the new file
+bool compactDatabase(RecordList& list, Journal& journal, const string& database, DatabaseFormat format)
+{
+    if (!commitJournal(journal) || !writeRecordsToFile(list, database, true, format))
+    {
+        return false;
+    }
+    journal.file.close();
+    JournalHeader header{ journalHeaderFor(database) };
+    if (!writeJournalFile(journal.filename, header, string_view()))
+    {
+        return false;
+    }
+    journal.file.open(journal.filename, ios::out | ios::binary | ios::app);
+    journal.size = sizeof(JournalHeader);
+    journal.baseSize = header.baseSize;
+    return static_cast<bool>(journal.file);
+}
+
+//function to add new record to end of linked list
+//fields are given exactly as they appeared in the batch file (revenue without its $)
+void addRecord(RecordList& list, ReportSink& report, string_view name, string_view highScore, string_view initials, string_view plays, string_view revenue)
+{
+    //create new GameData node with extracted information from command line
+    //(fields are stored as numbers, but printed exactly as they were given)
+    GameData* newGame = newRecord(list, name);
+    setHighScore(list, *newGame, highScore);
+    setInitials(list, *newGame, initials);
+    setPlays(list, *newGame, plays);
+    setRevenue(list, *newGame, revenue);
+
+    //append new node after the tail; the list keeps track of its tail, so there is no need to walk to the end
+    appendNode(list, newGame);
+
+    //output added record's details to report
+    ++report.counts.added;
+    report << "RECORD ADDED\n" << "Name: " << name << '\n'
+        << "High Score: " << highScore << '\n'
+        << "Initials: " << initials << '\n'
+        << "Plays: " << plays << '\n'
+        << "Revenue: " << '$' << revenue << '\n' << '\n';
+}
+
+//function to report a record found by a search
+void reportFoundRecord(ReportSink& report, const GameData& node)
+{
+    ++report.counts.searchMatches;
+
+    //output found record's details to report
+    report << node.name.view() << " FOUND\n"
+        << "High Score: " << highScoreText(node) << '\n'
+        << "Initials: " << initialsText(node) << '\n'
+        << "Plays: " << playsText(node) << '\n'
+        << "Revenue: " << '$' << revenueText(node) << '\n' << '\n';
+}
+
+//function to search for record given a search term
+void searchRecord(RecordList& list, ReportSink& report, string_view searchTerm)
+{
+    ++report.counts.searches;
+
+    //find every record whose name contains search term (ignoring case), in list order
+    //the search index means only records sharing a trigram with the term are looked at
+    toLowercase(searchTerm, list.searchTerm);
+    findNamesContaining(list, list.searchTerm, list.searchMatches);
+
+    //create flag to track if search term is found in any of the records
+    bool searchTermFound{ !list.searchMatches.empty() };
+
+    for (GameData* currentNode : list.searchMatches)
+    {
+        reportFoundRecord(report, *currentNode);
+    }
+
+    //if search term not found after going through all database lines, print message accordingly
+    if (!searchTermFound)
+    {
+        ++report.counts.searchesNotFound;
+        report << searchTerm << " NOT FOUND\n";
+    }
+}
+
+//function to change one field of a record being edited and report it ('field' is HighScore, Initials or Plays)
+//each field's edit is its own instantiation, which moves the record only in the ordered indexes of the fields it changes
+template <SortKey field>
+void editField(RecordList& list, ReportSink& report, GameData& node, string_view newValue)
+{
+    if constexpr (field == SortKey::HighScore)
+    {
+        //update high score to new value provided in command line
+        removeFromOrderedIndex<SortKey::HighScore>(list, &node);
+        setHighScore(list, node, newValue);
+        addToOrderedIndex<SortKey::HighScore>(list, &node);
+
+        //output edited record's details to report
+        ++report.counts.edited;
+        report << node.name.view() << " UPDATED\n"
+            << "UPDATE TO high score - VALUE " << cutLeadingZeroes(newValue) << '\n'
+            << "Name: " << node.name.view() << '\n'
+            << "High Score: " << cutLeadingZeroes(newValue) << '\n'
+            << "Initials: " << initialsText(node) << '\n'
+            << "Plays: " << playsText(node) << '\n'
+            << "Revenue: " << '$' << revenueText(node) << '\n' << '\n';
+    }
+    else if constexpr (field == SortKey::Initials)
+    {
+        //update player's initials to new value provided (no ordered index is on initials)
+        setInitials(list, node, newValue);
+
+        //output edited record's details to report
+        ++report.counts.edited;
+        report << node.name.view() << " UPDATED\n"
+            << "UPDATE TO initials - VALUE " << newValue << '\n'
+            << "Name: " << node.name.view() << '\n'
+            << "High Score: " << highScoreText(node) << '\n'
+            << "Initials: " << newValue << '\n'
+            << "Plays: " << playsText(node) << '\n'
+            << "Revenue: " << '$' << revenueText(node) << '\n' << '\n';
+    }
+    else
+    {
+        static_assert(field == SortKey::Plays, "only high score, initials and plays can be edited");
+
+        //update number of plays to new value provided
+        removeFromOrderedIndex<SortKey::Plays>(list, &node);
+        removeFromOrderedIndex<SortKey::Revenue>(list, &node);
+        setPlays(list, node, newValue);
+
+        //since our plays changed, we need to recalculate revenue (multiply new value by 0.25)
+        //this is 25 cents even after a reprice: a reprice's price is not kept (freeplay.dat has nowhere to keep it), so
+        //an edit prices plays as the program always has
+        //plain whole numbers of plays give an exact number of cents (25 per play), so no floating point is needed
+        long long playCount{ 0 };
+        if (exactCents(newValue, playCount) && playCount % 100 == 0)
+        {
+            node.revenue = playCount / 100 * 25;
+            keepFieldText(list, node, &RecordText::revenue, string_view(), true);
+        }
+        else
+        {
+            setRevenue(list, node, parseDouble(newValue) * 0.25);
+        }
+        addToOrderedIndex<SortKey::Plays>(list, &node);
+        addToOrderedIndex<SortKey::Revenue>(list, &node);
+
+        //output edited record's details to report
+        ++report.counts.edited;
+        report << node.name.view() << " UPDATED\n"
+            << "UPDATE TO plays - VALUE " << cutLeadingZeroes(newValue) << '\n'
+            << "Name: " << node.name.view() << '\n'
+            << "High Score: " << highScoreText(node) << '\n'
+            << "Initials: " << initialsText(node) << '\n'
+            << "Plays: " << cutLeadingZeroes(newValue) << '\n'
+            << "Revenue: " << '$' << revenueText(node) << '\n' << '\n';
+    }
+}
+
+//function to edit specific record within linked list
+void editRecord(RecordList& list, ReportSink& report, string_view batchfileName, char fieldNumber, string_view newValue)
+{
+    //look up first record with this exact name in the name index (instead of walking the whole list)
+    GameData* currentNode = findFirstByName(list, batchfileName);
+
+    //if batchfile name to edit cannot be found in linked list, print message accordingly
+    if (currentNode == nullptr)
+    {
+        ++report.counts.editsNotFound;
+        report << "Record to edit was not found.\n";
+        return;
+    }
+
+    //concurrent readers get the edited record with the next published view; columns are copied afresh when next needed
+    list.columns.built = false;
+    if (list.shared != nullptr)
+    {
+        list.shared->pending.push_back(PendingChange{ PendingChange::Edited, currentNode, currentNode->order });
+    }
+
+    //update correct field with new value depending on the field number (1 is high score, 2 initials, 3 plays and thus
+    //revenue); the field is picked here once, and the edit itself is specialized for it
+    switch (fieldNumber)
+    {
+    case '1':
+        editField<SortKey::HighScore>(list, report, *currentNode, newValue);
+        break;
+    case '2':
+        editField<SortKey::Initials>(list, report, *currentNode, newValue);
+        break;
+    case '3':
+        editField<SortKey::Plays>(list, report, *currentNode, newValue);
+        break;
+    }
+}
+
+//function to delete a record from linked list, given a game name
+void deleteRecord(RecordList& list, ReportSink& report, string_view recordToDelete)
+{
+    //look up first record whose name matches ignoring case in the name index (instead of walking the whole list)
+    GameData* currentNode = findFirstByNameIgnoreCase(list, recordToDelete);
+
+    //if there is no such record, print message accordingly
+    if (currentNode == nullptr)
+    {
+        ++report.counts.deletesNotFound;
+        report << "Record to delete was not found in the database file.\n";
+        return;
+    }
+
+    //output deleted record's details to report (before node is freed)
+    ++report.counts.deleted;
+    report << "RECORD DELETED\n"
+        << "Name: " << currentNode->name.view() << '\n'
+        << "High Score: " << highScoreText(*currentNode) << '\n'
+        << "Initials: " << initialsText(*currentNode) << '\n'
+        << "Plays: " << playsText(*currentNode) << '\n'
+        << "Revenue: " << '$' << revenueText(*currentNode) << '\n' << '\n';
+
+    //take node out of list and name index, then give its memory back to the node pool (effectively deletes record)
+    unlinkNode(list, currentNode);
+    freeRecord(list, currentNode);
+}
+
+//function to work out plays times a price per play (in cents) into 'revenue'
+//returns false, leaving 'revenue' alone, if the product does not fit in a long long
+bool revenueAtPrice(long long plays, long long price, long long& revenue)
+{
+#if defined(__GNUC__)
+    long long product;
+    if (__builtin_mul_overflow(plays, price, &product))
+    {
+        return false;
+    }
+    revenue = product;
+    return true;
+#else
+    //prices are parsed from digits, so are never negative
+    if (price != 0 && (plays > numeric_limits<long long>::max() / price || plays < numeric_limits<long long>::min() / price))
+    {
+        return false;
+    }
+    revenue = plays * price;
+    return true;
+#endif
+}
+
+//function to set every revenue in a column to plays times the price per play (in cents), returning how many changed
+//a revenue that would not fit is left as it was, and counted in 'overflowed'
+//one pass over plain arrays of cents, with no branches, so the compiler can vectorize it
+size_t repriceColumn(const long long* plays, long long* revenue, size_t count, long long price, size_t& overflowed)
+{
+    size_t changed{ 0 };
+    size_t overflows{ 0 };
+    for (size_t i{ 0 }; i < count; ++i)
+    {
+        long long value{ revenue[i] };
+        bool fits{ revenueAtPrice(plays[i], price, value) };
+        overflows += fits ? 0 : 1;
+        changed += value != revenue[i] ? 1 : 0;
+        revenue[i] = value;
+    }
+    overflowed = overflows;
+    return changed;
+}
+
+//function to recompute revenue as plays times a price per play (in cents), for every record or for every record of one
+//game (when 'gameName' is not empty), without reporting anything; returns how many records' revenue changed, and sets
+//'found' if there was anything to reprice
+//a record whose new revenue would not fit keeps its revenue, and is put in list.repriceOverflows (in list order)
+size_t repriceMatching(RecordList& list, string_view gameName, long long price, bool& found)
+{
+    size_t changed{ 0 };
+    list.repriceOverflows.clear();
+    if (gameName.empty())
+    {
+        //work out every new revenue in the revenue column, then store them in the nodes (which keeps the columns valid)
+        buildColumns(list);
+        RecordColumns& columns = list.columns;
+        countVisited(list, columns.nodes.size());
+        size_t overflowed{ 0 };
+        changed = repriceColumn(columns.plays.data(), columns.revenue.data(), columns.revenue.size(), price, overflowed);
+        long long unused{ 0 };
+        for (size_t row{ 0 }; row < columns.nodes.size(); ++row)
+        {
+            GameData* node = columns.nodes[row];
+            if (overflowed > 0 && !revenueAtPrice(node->plays, price, unused))
+            {
+                list.repriceOverflows.push_back(node);
+                continue;
+            }
+            node->revenue = columns.revenue[row];
+            keepFieldText(list, *node, &RecordText::revenue, string_view(), true);
+        }
+
+        //every record may have changed, so concurrent readers get a view copied afresh, and the revenue index is
+        //built again when next needed
+        if (list.shared != nullptr)
+        {
+            list.shared->rebuild = true;
+        }
+        OrderedIndex* revenueIndex = orderedIndexFor(list, SortKey::Revenue);
+        revenueIndex->blocks.clear();
+        revenueIndex->built = false;
+        found = true;
+        return changed;
+    }
+
+    //every record whose name matches exactly is in the name index chain for that name
+    buildNameIndex(list);
+    size_t slot{ findNameSlot(list.nameIndex, gameName, hashNameIgnoreCase(gameName)) };
+    found = false;
+    for (GameData* node = slot == string::npos ? nullptr : list.nameIndex.slots[slot].chain; node != nullptr; node = node->nextSameName)
+    {
+        countVisited(list, 1);
+        if (node->name.view() != gameName)
+        {
+            continue;
+        }
+        found = true;
+        long long revenue{ 0 };
+        if (!revenueAtPrice(node->plays, price, revenue))
+        {
+            //the name index chain is not in list order, so the records left alone are put back in list order
+            auto position = upper_bound(list.repriceOverflows.begin(), list.repriceOverflows.end(), node,
+                [](const GameData* a, const GameData* b) { return a->order < b->order; });
+            list.repriceOverflows.insert(position, node);
+            continue;
+        }
+        changed += revenue != node->revenue ? 1 : 0;
+        removeFromOrderedIndexes(list, node);
+        node->revenue = revenue;
+        addToOrderedIndexes(list, node);
+        keepFieldText(list, *node, &RecordText::revenue, string_view(), true);
+        list.columns.built = false;
+        if (list.shared != nullptr)
+        {
+            list.shared->pending.push_back(PendingChange{ PendingChange::Edited, node, node->order });
+        }
+    }
+    return changed;
+}
+
+//function to recompute revenue as plays times a price per play (see repriceMatching), and report each record whose
+//new revenue would not fit, then how many records' revenue changed
+void repriceRecords(RecordList& list, ReportSink& report, string_view gameName, long long price)
+{
+    bool found{ false };
+    size_t changed{ repriceMatching(list, gameName, price, found) };
+    if (!found)
+    {
+        ++report.counts.repricesNotFound;
+        report << "Game to reprice was not found.\n";
+        return;
+    }
+    for (const GameData* node : list.repriceOverflows)
+    {
+        reportRepriceOverflow(report, *node, price);
+    }
+    reportReprice(report, gameName, price, changed);
+}
+
+//function to report a record a reprice left alone, because its plays times the price is too large to keep
+void reportRepriceOverflow(ReportSink& report, const GameData& node, long long price)
+{
+    report << "REVENUE OF " << node.name.view() << " NOT RECOMPUTED: " << playsText(node) << " PLAYS AT "
+        << aggregateValueText(SortKey::Revenue, price) << " PER PLAY IS TOO LARGE\n";
+}
+
+//function to report a reprice command that found what it had to reprice (every game, when 'gameName' is empty)
+void reportReprice(ReportSink& report, string_view gameName, long long price, size_t changed)
+{
+    ++report.counts.reprices;
+    report.counts.repricedRecords += changed;
+    report << "REVENUE ";
+    if (!gameName.empty())
+    {
+        report << "OF " << gameName << ' ';
+    }
+    report << "RECOMPUTED AT " << aggregateValueText(SortKey::Revenue, price) << " PER PLAY\n"
+        << "Records changed: " << to_string(changed) << '\n' << '\n';
+}
+
+//function to turn the sort method from the batch file into a sort key and direction
+//returns false (leaving method.known false) if the method names a key we do not know how to sort by
+bool parseSortMethod(string_view text, SortMethod& method)
+{
+    SortKey& key = method.key;
+    bool& descending = method.descending;
+
+    //split method into key word and optional direction word (e.g. "plays desc")
+    size_t space{ text.find(' ') };
+    string_view keyWord{ text.substr(0, space) };
+    string_view directionWord{ space == string_view::npos ? "" : text.substr(space + 1) };
+
+    //anything other than nothing, "asc" or "desc" after the key is not a valid method;
+    //a space with no direction word after it ("plays ") is not nothing
+    if ((space == string_view::npos) || directionWord == "asc" || directionWord == "ascending")
+    {
+        descending = false;
+    }
+    else if (directionWord == "desc" || directionWord == "descending")
+    {
+        descending = true;
+    }
+    else
+    {
+        return false;
+    }
+
+    //match key word against the fields we can sort by
+    if (keyWord == "name")
+    {
+        key = SortKey::Name;
+    }
+    else if (keyWord == "plays")
+    {
+        key = SortKey::Plays;
+    }
+    else if (keyWord == "highscore")
+    {
+        key = SortKey::HighScore;
+    }
+    else if (keyWord == "revenue")
+    {
+        key = SortKey::Revenue;
+    }
+    else if (keyWord == "initials")
+    {
+        key = SortKey::Initials;
+    }
+    else
+    {
+        return false;
+    }
+    method.known = true;
+    return true;
+}
+
+//function to get the name printed in the "RECORDS SORTED BY" header for a sort key
+const char* sortKeyName(SortKey key)
+{
+    switch (key)
+    {
+    case SortKey::Name:      return "name";
+    case SortKey::Plays:     return "plays";
+    case SortKey::HighScore: return "highscore";
+    case SortKey::Revenue:   return "revenue";
+    case SortKey::Initials:  return "initials";
+    }
+    return "plays";
+}
+
+//cell used while sorting: holds the key of one node (extracted once) and links cells together like the list itself
+template <typename Key>
+struct SortCell
+{
+    Key key;            //sort key taken from the node
+    GameData* node;     //node this key belongs to
+    SortCell* next;     //next cell in the chain being sorted
+};
+
+//function to merge two sorted cell chains into one; ties keep the left chain first so the sort is stable
+//(the direction is a template argument, so the comparison in the loop is the only test made per cell)
+template <typename Key, bool descending>
+SortCell<Key>* mergeCells(SortCell<Key>* left, SortCell<Key>* right, SortCell<Key>*& tail)
+{
+    SortCell<Key> dummy{};          //placeholder in front of merged chain so we don't need to special-case the first cell
+    SortCell<Key>* last = &dummy;   //last cell of merged chain so far
+
+    //keep taking the smaller front cell until one of the chains runs out
+    while (left != nullptr && right != nullptr)
+    {
+        //only take from right chain if its key strictly belongs in front of the left key
+        bool takeRight = descending ? left->key < right->key : right->key < left->key;
+        if (takeRight)
+        {
+            last->next = right;
+            right = right->next;
+        }
+        else
+        {
+            last->next = left;
+            left = left->next;
+        }
+        last = last->next;
+    }
+
+    //attach whatever is left over, and walk to its end so caller knows the tail of the merged chain
+    last->next = (left != nullptr) ? left : right;
+    while (last->next != nullptr)
+    {
+        last = last->next;
+    }
+    tail = last;
+    return dummy.next;
+}
+
+//function to cut 'count' cells off the front of a chain; returns the rest of the chain
+template <typename Key>
+SortCell<Key>* splitCells(SortCell<Key>* chain, size_t count)
+{
+    //walk to the last cell that belongs to the first part
+    for (size_t i{ 1 }; chain != nullptr && i < count; ++i)
+    {
+        chain = chain->next;
+    }
+    if (chain == nullptr)
+    {
+        return nullptr;
+    }
+
+    //detach the first part and hand back the rest
+    SortCell<Key>* rest = chain->next;
+    chain->next = nullptr;
+    return rest;
+}
+
+//function to stably sort the linked list by a field, using a bottom-up merge sort
+//each node's key is taken exactly once (by RecordField<field>::key), and the list is relinked in the sorted order at the end
+template <SortKey field, bool descending>
+void mergeSortList(RecordList& list)
+{
+    using Key = typename RecordField<field>::Key;
+#ifdef ARCADE_CONTIGUOUS_STORE
+    //the records themselves are moved into sorted order, so every position has to hold one: drop the tombstones first
+    compactRecords(list);
+#endif
+    size_t size{ list.size };
+
+    //build one cell per node, in current list order, with its key already extracted
+    vector<SortCell<Key>> cells(size);
+    size_t index{ 0 };
+    for (GameData* node = firstRecord(list); node != nullptr; node = nextRecord(list, node), ++index)
+    {
+        cells[index].key = RecordField<field>::key(*node);
+        cells[index].node = node;
+        cells[index].next = (index + 1 < size) ? &cells[index + 1] : nullptr;
+    }
+    SortCell<Key>* chain = &cells[0];
+
+    //merge runs of width 1, 2, 4, ... until a single run covers the whole list
+    for (size_t width{ 1 }; width < size; width *= 2)
+    {
+        SortCell<Key>* remaining = chain;  //part of chain not yet merged in this pass
+        SortCell<Key> dummy{};             //placeholder in front of the chain being rebuilt
+        SortCell<Key>* tail = &dummy;      //last cell of the rebuilt chain
+
+        while (remaining != nullptr)
+        {
+            //take two neighbouring runs of 'width' cells each and merge them
+            SortCell<Key>* left = remaining;
+            SortCell<Key>* right = splitCells(left, width);
+            remaining = splitCells(right, width);
+
+            SortCell<Key>* mergedTail = nullptr;
+            tail->next = mergeCells<Key, descending>(left, right, mergedTail);
+            tail = mergedTail;
+        }
+        chain = dummy.next;
+    }
+
+#ifdef ARCADE_CONTIGUOUS_STORE
+    //move the records into the order of the sorted cells (each cell's node is still at its old position)
+    vector<size_t> source;
+    source.reserve(size);
+    for (SortCell<Key>* cell = chain; cell != nullptr; cell = cell->next)
+    {
+        source.push_back(static_cast<size_t>(cell->node->order));
+    }
+    permuteRecords(list, source);
+#else
+    //relink the nodes themselves in the order of the sorted cells, renumbering their order stamps as we go
+    list.head = chain->node;
+    GameData* previous = nullptr;
+    list.nextOrder = 0;
+    for (SortCell<Key>* cell = chain; cell != nullptr; cell = cell->next)
+    {
+        cell->node->prev = previous;
+        cell->node->next = (cell->next != nullptr) ? cell->next->node : nullptr;
+        cell->node->order = list.nextOrder++;
+        previous = cell->node;
+    }
+    list.tail = previous;
+#endif
+}
+
+//function to merge sort the list by one field, picking the instantiation for the direction once
+template <SortKey field>
+void mergeSortByField(RecordList& list, bool descending)
+{
+    if (descending)
+    {
+        mergeSortList<field, true>(list);
+    }
+    else
+    {
+        mergeSortList<field, false>(list);
+    }
+}
+
+//function to sort linked list of game records based on specified sort method (ascending unless "desc" is given)
+void sortRecords(RecordList& list, ReportSink& report, const SortMethod& sortMethod)
+{
+    //if list is empty or contains only one node, no sorting is needed
+    if (list.size < 2)
+    {
+        return;
+    }
+
+    //what to sort by was worked out when the batch file was read, not on every comparison
+    bool descending{ sortMethod.descending };
+    countVisited(list, list.size);
+
+    //unknown sort methods leave the list in its current order (and are reported as plays, as before)
+    if (sortMethod.known)
+    {
+        //a field whose ordered index is built is sorted by walking the index, which takes no comparisons at all;
+        //otherwise merge sort with the instantiation for the field and direction, whose key type matches the field,
+        //so comparisons never re-parse strings or check which field they are on
+        bool walked{ sortByOrderedIndex(list, sortMethod.key, descending) };
+        if (!walked)
+        {
+            switch (sortMethod.key)
+            {
+            case SortKey::Name:
+                mergeSortByField<SortKey::Name>(list, descending);
+                break;
+            case SortKey::Initials:
+                mergeSortByField<SortKey::Initials>(list, descending);
+                break;
+            case SortKey::Plays:
+                mergeSortByField<SortKey::Plays>(list, descending);
+                break;
+            case SortKey::HighScore:
+                mergeSortByField<SortKey::HighScore>(list, descending);
+                break;
+            case SortKey::Revenue:
+                mergeSortByField<SortKey::Revenue>(list, descending);
+                break;
+            }
+        }
+
+        //every record moved, so concurrent readers get a view copied afresh, and columns are copied again
+        list.columns.built = false;
+        if (list.shared != nullptr)
+        {
+            list.shared->rebuild = true;
+        }
+
+        //the other ordered indexes have records with the same value in the old list order, so they are dropped; the
+        //index of the field sorted by is kept in step by the walk, or read straight off the list after a merge sort
+        //(either way, the next sort by it is a walk)
+        OrderedIndex* sortedIndex = orderedIndexFor(list, sortMethod.key);
+        for (OrderedIndex& index : list.orderedIndexes)
+        {
+            if (&index != sortedIndex)
+            {
+                index.blocks.clear();
+                index.built = false;
+            }
+        }
+        if (!walked)
+        {
+            indexSortedList(list, sortMethod.key, descending);
+        }
+    }
+
+    //after sorting, print sorted list to report (skipped entirely in quiet mode, where it would only be thrown away):
+    ++report.counts.sorts;
+    if (report.quiet)
+    {
+        return;
+    }
+
+    //print out the key we sorted by (and the direction, if it was descending)
+    reportSortHeading(report, sortMethod);
+
+    //traverse through entire linked list of currents
+    for (GameData* node = firstRecord(list); node != nullptr; node = nextRecord(list, node))
+    {
+        //print out game record data for each node (same line format as the database file)
+        appendRecordLine(report.buffer, *node);
+        if (report.buffer.size() >= report.flushSize && !report.hold)
+        {
+            flushReport(report);
+        }
+    }
+    report << '\n';
+}
+
+//function to print the first line of a sort's report: the key sorted by, and the direction if it was descending
+void reportSortHeading(ReportSink& report, const SortMethod& sortMethod)
+{
+    report << "RECORDS SORTED BY " << (sortMethod.known ? sortKeyName(sortMethod.key) : "plays") << (sortMethod.descending ? " DESCENDING" : "") << '\n';
+}
+
+//function to check whether record 'a' belongs before 'b' under a sort method that wasn't recognised: it never does,
+//since an unknown method leaves records where they are
+bool neverBefore(const GameData&, const GameData&)
+{
+    return false;
+}
+
+//function to get the comparison of records that a sort method puts records in order by (the same comparison mergeCells
+//makes), so a merge of sorted records calls the instantiation for its field and direction directly
+RecordOrder recordOrderFor(const SortMethod& sortMethod)
+{
+    if (!sortMethod.known)
+    {
+        return neverBefore;
+    }
+    bool descending{ sortMethod.descending };
+    switch (sortMethod.key)
+    {
+    case SortKey::Name:
+        return descending ? recordBefore<SortKey::Name, true> : recordBefore<SortKey::Name, false>;
+    case SortKey::Initials:
+        return descending ? recordBefore<SortKey::Initials, true> : recordBefore<SortKey::Initials, false>;
+    case SortKey::Plays:
+        return descending ? recordBefore<SortKey::Plays, true> : recordBefore<SortKey::Plays, false>;
+    case SortKey::HighScore:
+        return descending ? recordBefore<SortKey::HighScore, true> : recordBefore<SortKey::HighScore, false>;
+    case SortKey::Revenue:
+        return descending ? recordBefore<SortKey::Revenue, true> : recordBefore<SortKey::Revenue, false>;
+    }
+    return neverBefore;
+}
+
+//function to turn the argument of an aggregate command ("sum plays", "top revenue 10", ...) into a query
+//returns false if the function, field or number is not one we know
+bool parseAggregateQuery(string_view text, AggregateQuery& query)
+{
+    query.text = text;
+
+    //split into function word, field word and optional number
+    size_t space1{ text.find(' ') };
+    if (space1 == string_view::npos)
+    {
+        return false;
+    }
+    size_t space2{ text.find(' ', space1 + 1) };
+    string_view functionWord{ text.substr(0, space1) };
+    string_view fieldWord{ text.substr(space1 + 1, space2 == string_view::npos ? string_view::npos : space2 - (space1 + 1)) };
+    string_view numberWord{ space2 == string_view::npos ? "" : text.substr(space2 + 1) };
+
+    //fields that can be aggregated are the numeric ones
+    if (fieldWord == "plays")
+    {
+        query.field = SortKey::Plays;
+    }
+    else if (fieldWord == "highscore")
+    {
+        query.field = SortKey::HighScore;
+    }
+    else if (fieldWord == "revenue")
+    {
+        query.field = SortKey::Revenue;
+    }
+    else
+    {
+        return false;
+    }
+
+    //sum, min and max take no number; top and histogram take a count, percentile takes a percentage
+    if (functionWord == "sum" || functionWord == "min" || functionWord == "max")
+    {
+        query.function = functionWord == "sum" ? AggregateFunction::Sum
+                       : functionWord == "min" ? AggregateFunction::Min : AggregateFunction::Max;
+        return numberWord.empty();
+    }
+    if (functionWord == "top" || functionWord == "histogram")
+    {
+        query.function = functionWord == "top" ? AggregateFunction::Top : AggregateFunction::Histogram;
+        const char* end = numberWord.data() + numberWord.size();
+        auto result = from_chars(numberWord.data(), end, query.count);
+        return !numberWord.empty() && result.ec == errc() && result.ptr == end && query.count > 0;
+    }
+    if (functionWord == "percentile")
+    {
+        query.function = AggregateFunction::Percentile;
+        if (numberWord.empty() || numberWord.find_first_not_of("0123456789.") != string_view::npos)
+        {
+            return false;
+        }
+        query.percentile = parseDouble(numberWord);
+        return query.percentile <= 100;
+    }
+    return false;
+}
+
+//function to copy the numeric fields of every record into columns, in list order (does nothing if they are up to date)
+void buildColumns(RecordList& list)
+{
+    RecordColumns& columns = list.columns;
+    if (columns.built)
+    {
+        return;
+    }
+    columns.built = true;
+    columns.highScore.resize(list.size);
+    columns.plays.resize(list.size);
+    columns.revenue.resize(list.size);
+    columns.nodes.resize(list.size);
+    size_t row{ 0 };
+    for (GameData* node = firstRecord(list); node != nullptr; node = nextRecord(list, node), ++row)
+    {
+        columns.highScore[row] = node->highScore;
+        columns.plays[row] = node->plays;
+        columns.revenue[row] = node->revenue;
+        columns.nodes[row] = node;
+    }
+}
 
-    //close both files after all operations are completed
-    batchfile.close();
-    datfile.close();
+//function to get the column holding a field
+const vector<long long>& columnFor(const RecordColumns& columns, SortKey field)
+{
+    return field == SortKey::HighScore ? columns.highScore : field == SortKey::Revenue ? columns.revenue : columns.plays;
+}
 
-    //return 0 to indicate successful execution of program
-    return 0;
+//function to get a numeric field of a record
+long long fieldValue(const GameData& node, SortKey field)
+{
+    return field == SortKey::HighScore ? node.highScore : field == SortKey::Revenue ? node.revenue : node.plays;
 }
 
-//function to convert string to lowercase
-string toLowercase(string original)
+//function to add 'value' to a total that wraps around, counting the times it wraps: up past the largest long long
+//(+1) or down past the smallest (-1); the exact total is then total + wraps * 2^64, so it fits only if wraps is 0
+void addCountingWraps(long long& total, long long& wraps, long long value)
 {
-    //loop through each character in string
-    for (size_t i = 0; i < original.size(); ++i)
-    {
-        //convert current character to lowercase equivalent,
-        //converting to 'char' type for compatibility with 'string' type
-        original[i] = static_cast<char>(tolower(original[i]));
-    }
-    //return modified string with lowercase letters
-    return original;
+    long long sum{ static_cast<long long>(static_cast<unsigned long long>(total) + static_cast<unsigned long long>(value)) };
+    wraps += (value >= 0 && sum < total ? 1 : 0) - (value < 0 && sum > total ? 1 : 0);
+    total = sum;
 }
 
-//function to remove leading zeros from string
-string cutLeadingZeroes(string original) 
+//SIMD kernels over a column: four values per instruction with AVX2, otherwise four independent lanes
+//(which the compiler can vectorize with whatever the target has); the last few values are done one at a time
+//each lane counts the times its total wraps around (see addCountingWraps), so 'overflowed' says exactly whether the
+//whole sum is too large (or small) for a long long, whatever order the values were added in
+long long sumColumn(const long long* values, size_t count, bool& overflowed)
 {
-    //loop through each charactter in string
-    for (size_t i{ 0 }; i < original.size(); ++i)
+    size_t i{ 0 };
+    long long total{ 0 };
+    long long wraps{ 0 };
+#if defined(__AVX2__)
+    //a lane wrapped up if it added a value that isn't negative and its total went down, and down if the reverse
+    __m256i lanes = _mm256_setzero_si256();
+    __m256i laneWraps = _mm256_setzero_si256();
+    const __m256i zero = _mm256_setzero_si256();
+    for (; i + 4 <= count; i += 4)
     {
-        //if current character isn't '0'
-        if (original[i] != '0')
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        __m256i sum = _mm256_add_epi64(lanes, value);
+        __m256i negative = _mm256_cmpgt_epi64(zero, value);
+        laneWraps = _mm256_sub_epi64(laneWraps, _mm256_andnot_si256(negative, _mm256_cmpgt_epi64(lanes, sum)));
+        laneWraps = _mm256_add_epi64(laneWraps, _mm256_and_si256(negative, _mm256_cmpgt_epi64(sum, lanes)));
+        lanes = sum;
+    }
+    alignas(32) long long parts[4];
+    alignas(32) long long partWraps[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(parts), lanes);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(partWraps), laneWraps);
+#else
+    long long parts[4]{ 0, 0, 0, 0 };
+    long long partWraps[4]{ 0, 0, 0, 0 };
+    for (; i + 4 <= count; i += 4)
+    {
+        for (size_t lane{ 0 }; lane < 4; ++lane)
         {
-            //create new string starting from this nonzero character to end of original string
-            string withoutLeadingZeros{ original.substr(i) };
-
-            //return modified string without leading zeros
-            return withoutLeadingZeros;
+            addCountingWraps(parts[lane], partWraps[lane], values[i + lane]);
         }
     }
-    //if whole string is '0's or empty, return only one '0' to indicate value is zero
-    return "0";
+#endif
+    for (size_t lane{ 0 }; lane < 4; ++lane)
+    {
+        addCountingWraps(total, wraps, parts[lane]);
+        wraps += partWraps[lane];
+    }
+    for (; i < count; ++i)
+    {
+        addCountingWraps(total, wraps, values[i]);
+    }
+    overflowed = wraps != 0;
+    return total;
 }
 
-//function to read data from database file and create linked list of GameData structures
-void createLinkedList(GameData*& head, fstream& datfile)
+//finds smallest and largest value of a column ('count' must be at least 1)
+void columnRange(const long long* values, size_t count, long long& low, long long& high)
 {
-    GameData* tail = nullptr; //keeps track of last node in linked list
-    string datfileLine;       //string variable to store each line form database file
-
-    //keep reading lines from database file until we get to end of file
-    while (getline(datfile, datfileLine))
-    {        
-       //create stringstream from line so we can extract different fields of game record
-        stringstream line(datfileLine);
-
-        //create variables to store each field of game record
-        string datfileName, highScore, initials, plays, revenue;
-
-        //Extract fields: use commas to parse since each field is separated by a comma in the database file       
-        getline(line, datfileName, ',');    //extract game name
-       
-        getline(line, highScore, ',');      //extract high score 
-        highScore = highScore.substr(1);  //remove leading space so high score only contains the numbers
-
-        getline(line, initials, ',');       //extract initials
-        initials = initials.substr(1);    //remove leading space so initials only contains the letter
-
-        getline(line, plays, ',');          //extract plays
-        plays = plays.substr(1);          //remove leading space so plays only contains the numbers
-
-        getline(line, revenue, ',');        //extract revenue
-        revenue = revenue.substr(2);      //remove leading space and $ so revenue only contains numbers and decimal point
-           
-        //format highScore and plays to remove leading zeroes
-        highScore = cutLeadingZeroes(highScore);
-        plays = cutLeadingZeroes(plays);
-
-        //create stringstream object to format revenue:
-        stringstream formattedRevenue; 
-        double revenueValue = stod(revenue);                             //convert revenue from string to double value
-        formattedRevenue << fixed << setprecision(2) << revenueValue;    //ensure revenue is a double with 2 decimal places
-        revenue = formattedRevenue.str();                                //convert back to string
-
-        //create new GameData node with extracted data
-        GameData* newGame = new GameData
-        {
-            datfileName,
-            highScore,
-            initials,
-            plays,
-            revenue,
-            nullptr //next node pointer (currently set to nullptr since this is last node)
-        };
-        //if list is currently empty, this new node becomes head and tail
-        if (head == nullptr) 
-        {
-            head = newGame; 
-            tail = newGame; 
-        }
-        //otherwise: 
-        else 
+    size_t i{ 0 };
+    low = values[0];
+    high = values[0];
+#if defined(__AVX2__)
+    __m256i lows = _mm256_set1_epi64x(values[0]);
+    __m256i highs = lows;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        lows = _mm256_blendv_epi8(lows, value, _mm256_cmpgt_epi64(lows, value));
+        highs = _mm256_blendv_epi8(highs, value, _mm256_cmpgt_epi64(value, highs));
+    }
+    alignas(32) long long lowParts[4];
+    alignas(32) long long highParts[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lowParts), lows);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(highParts), highs);
+#else
+    long long lowParts[4]{ values[0], values[0], values[0], values[0] };
+    long long highParts[4]{ values[0], values[0], values[0], values[0] };
+    for (; i + 4 <= count; i += 4)
+    {
+        for (size_t lane{ 0 }; lane < 4; ++lane)
         {
-            tail->next = newGame;  //append new node to end of list
-            tail = newGame;        //update tail to new last node
+            lowParts[lane] = min(lowParts[lane], values[i + lane]);
+            highParts[lane] = max(highParts[lane], values[i + lane]);
         }
     }
+#endif
+    for (size_t lane{ 0 }; lane < 4; ++lane)
+    {
+        low = min(low, lowParts[lane]);
+        high = max(high, highParts[lane]);
+    }
+    for (; i < count; ++i)
+    {
+        low = min(low, values[i]);
+        high = max(high, values[i]);
+    }
 }
 
-//function to add new record to end of linked list
-void addRecord(GameData*& head, const string& commandLine)
+//counts how many values of a column fall in each of 'buckets.size()' buckets of 'width', the first starting at 'low'
+void countBuckets(const long long* values, size_t count, long long low, unsigned long long width, vector<size_t>& buckets)
 {
-    //parse command line to extract game data:
-
-    //find the first and second double quote to isolate name field
-    //use .find() to get position of first double quote in command line and store in variable
-    size_t doubleQuote1{ commandLine.find('\"') };
-    //create variable for position of 2nd double quote(.find() searches for first double quote after doubleQuote1)
-    size_t doubleQuote2{ commandLine.find('\"', doubleQuote1 + 1) };
-
-    /*use spaces as dilimiters for our fields
-      start searching at double quote instead of beginning of command line, because our name
-      can include spaces and punctuation(which would mistake our in-field comma/space for delimiter) */
-    size_t space1{ commandLine.find(' ', doubleQuote2) }; //get position of first space after 2nd double quote
-    size_t space2{ commandLine.find(' ', space1 + 1) };   //get position of first space after space1
-    size_t space3{ commandLine.find(' ', space2 + 1) };   //get position of first space after space2
-    size_t space4{ commandLine.find(' ', space3 + 1) };   //get position of first space after space3
-
-    //parse commandline string to extract fields (based on positions of quotes and spaces after quotes):
-
-    //extract name starting from right after first double quote all the way to before second double quote
-    //doubleQuote2 - (doubleQuote1 + 1) calculates the correct number of characters to extract for name
-    string name{ commandLine.substr(doubleQuote1 + 1, doubleQuote2 - (doubleQuote1 + 1)) };
-
-    //extract high score from commandline by getting portion starting after space1 all the way to before space2
-    //space2 - (space1 + 1) calculates the exact number of characters to extract for the highscore
-    string highScore{ commandLine.substr(space1 + 1, space2 - (space1 + 1)) };
-
-    //extract initials by getting portion of commandline starting after space2 all the way to before space3
-    //space3 - (space2 + 1) calculates the exact number of characters to extract for the initials
-    string initials{ commandLine.substr(space2 + 1, space3 - (space2 + 1)) };
+    for (size_t i{ 0 }; i < count; ++i)
+    {
+        ++buckets[(static_cast<unsigned long long>(values[i]) - static_cast<unsigned long long>(low)) / width];
+    }
+}
 
-    //extract plays by getting portion of commandline starting after space3 all the way to before space4
-    //space4 - (space3 + 1) calculates the exact number of characters to extract for plays
-    string plays{ commandLine.substr(space3 + 1, space4 - (space3 + 1)) };
+//function to work out the width of each histogram bucket, so 'bucketCount' buckets from 'low' cover up to 'high'
+unsigned long long bucketWidth(long long low, long long high, size_t bucketCount)
+{
+    return (static_cast<unsigned long long>(high) - static_cast<unsigned long long>(low)) / bucketCount + 1;
+}
 
-    //extract revenue by getting portion from after the $
-    string revenue{ commandLine.substr(space4 + 2) };
+//function to get the number of the value a percentile falls on (nearest rank, counting from 1), out of 'count'
+size_t percentileRank(double percentile, size_t count)
+{
+    size_t rank{ static_cast<size_t>(ceil(percentile / 100 * static_cast<double>(count))) };
+    return min(max(rank, size_t{ 1 }), count);
+}
 
-    //create new GameData node with extracted information from command line
-    GameData* newGame = new GameData
-    {
-        name,
-        highScore,
-        initials,
-        plays,
-        revenue,
-        nullptr  //next node in list (nullptr since this will be last node)
-    };
+//function to work out an aggregate over the columns
+AggregateResult aggregateColumns(RecordList& list, const AggregateQuery& query)
+{
+    buildColumns(list);
+    const vector<long long>& column = columnFor(list.columns, query.field);
+    AggregateResult result;
+    result.count = column.size();
+    if (column.empty())
+    {
+        return result;
+    }
 
-    //if list is empty, new node becomes head of linked list
-    if (head == nullptr)
+    switch (query.function)
     {
-        head = newGame;  //'head' is assigned address of 'newGame', making 'newGame' first node (head) of list
+    case AggregateFunction::Sum:
+        result.value = sumColumn(column.data(), column.size(), result.overflowed);
+        break;
+    case AggregateFunction::Min:
+    case AggregateFunction::Max:
+    {
+        long long low{ 0 };
+        long long high{ 0 };
+        columnRange(column.data(), column.size(), low, high);
+        result.value = query.function == AggregateFunction::Min ? low : high;
+        break;
     }
-    //otherwise, if list is not empty, find end of list and add new node there
-    else
+    case AggregateFunction::Top:
     {
-        //start searching at head of list
-        GameData* currentNode = head;
-
-        //traverse list starting from head until reaching last node
-        //last node is identified by its 'next' pointer being nullptr
-        //'current' traverses through nodes, moving to next as long as 'current->next' is not null
-        while (currentNode->next != nullptr)
+        //largest values first; records with equal values stay in list order
+        vector<size_t> rows(column.size());
+        for (size_t row{ 0 }; row < rows.size(); ++row)
         {
-            currentNode = currentNode->next; //move to next node in list
+            rows[row] = row;
         }
-        //when we reach end of list(when current->next is null), append 'newGame' to list by setting current->next to 'newGame'
-        //this links new node into list as last element
-        currentNode->next = newGame;
+        size_t count{ min(query.count, rows.size()) };
+        partial_sort(rows.begin(), rows.begin() + static_cast<ptrdiff_t>(count), rows.end(), [&column](size_t a, size_t b)
+        {
+            return column[a] != column[b] ? column[a] > column[b] : a < b;
+        });
+        for (size_t i{ 0 }; i < count; ++i)
+        {
+            result.records.push_back(list.columns.nodes[rows[i]]);
+        }
+        break;
     }
-
-    //output added record's details to console
-    cout << "RECORD ADDED\n" << "Name: " << name << '\n'
-        << "High Score: " << highScore << '\n'
-        << "Initials: " << initials << '\n'
-        << "Plays: " << plays << '\n'
-        << "Revenue: " << '$' << revenue << '\n' << '\n';
+    case AggregateFunction::Percentile:
+    {
+        vector<long long> values(column);
+        size_t rank{ percentileRank(query.percentile, values.size()) };
+        nth_element(values.begin(), values.begin() + static_cast<ptrdiff_t>(rank - 1), values.end());
+        result.value = values[rank - 1];
+        break;
+    }
+    case AggregateFunction::Histogram:
+    {
+        long long high{ 0 };
+        columnRange(column.data(), column.size(), result.low, high);
+        result.width = bucketWidth(result.low, high, query.count);
+        result.buckets.assign(query.count, 0);
+        countBuckets(column.data(), column.size(), result.low, result.width, result.buckets);
+        break;
+    }
+    }
+    return result;
 }
 
-//function to search for record given a search term
-void searchRecord(GameData*& head, const string& searchTerm)
+//function to work out an aggregate the simple way, one node at a time down the list (what --check-aggregates compares with)
+AggregateResult aggregateList(const RecordList& list, const AggregateQuery& query)
 {
-    //create flag to track if search term is found in any of the records
-    bool searchTermFound{ false };
+    AggregateResult result;
+    vector<GameData*> nodes;
+    for (GameData* node = firstRecord(list); node != nullptr; node = nextRecord(list, node))
+    {
+        nodes.push_back(node);
+    }
+    result.count = nodes.size();
+    if (nodes.empty())
+    {
+        return result;
+    }
 
-    //start from head of linked list
-    //'current' is used as pointer for traversing list
-    GameData* currentNode = head;
+    SortKey field{ query.field };
+    long long low{ fieldValue(*nodes[0], field) };
+    long long high{ low };
+    long long total{ 0 };
+    long long wraps{ 0 };
+    for (GameData* node : nodes)
+    {
+        long long value{ fieldValue(*node, field) };
+        addCountingWraps(total, wraps, value);
+        low = value < low ? value : low;
+        high = value > high ? value : high;
+    }
 
-    //loop through each node in list until end is reached (when current is nullptr)
-    while (currentNode != nullptr)
+    switch (query.function)
+    {
+    case AggregateFunction::Sum:
+        result.value = total;
+        result.overflowed = wraps != 0;
+        break;
+    case AggregateFunction::Min:
+        result.value = low;
+        break;
+    case AggregateFunction::Max:
+        result.value = high;
+        break;
+    case AggregateFunction::Top:
+        stable_sort(nodes.begin(), nodes.end(), [field](GameData* a, GameData* b) { return fieldValue(*a, field) > fieldValue(*b, field); });
+        nodes.resize(min(query.count, nodes.size()));
+        result.records = nodes;
+        break;
+    case AggregateFunction::Percentile:
     {
-        //if search term is found in name(using toLowercase functions on both names for case-insensitivity)
-        if (toLowercase(currentNode->name).find(toLowercase(searchTerm)) != string::npos)
+        vector<long long> values;
+        for (GameData* node : nodes)
         {
-            searchTermFound = true; //set flag to true since we found search term
-
-            //output found record's details to console 
-            cout << currentNode->name << " FOUND\n"
-                << "High Score: " << currentNode->highScore << '\n'
-                << "Initials: " << currentNode->initials << '\n'
-                << "Plays: " << currentNode->plays << '\n'
-                << "Revenue: " << '$' << currentNode->revenue << '\n' << '\n';
+            values.push_back(fieldValue(*node, field));
         }
-        //move to next node in list to continue search (by setting 'current' to next node)
-        currentNode = currentNode->next;
+        sort(values.begin(), values.end());
+        result.value = values[percentileRank(query.percentile, values.size()) - 1];
+        break;
     }
-
-    //if search term not found after going through all database lines, print message accordingly
-    if (!searchTermFound)
-    {
-        cout << searchTerm << " NOT FOUND\n";
+    case AggregateFunction::Histogram:
+        result.low = low;
+        result.width = bucketWidth(low, high, query.count);
+        result.buckets.assign(query.count, 0);
+        for (GameData* node : nodes)
+        {
+            ++result.buckets[(static_cast<unsigned long long>(fieldValue(*node, field)) - static_cast<unsigned long long>(low)) / result.width];
+        }
+        break;
     }
+    return result;
 }
 
-//function to edit specific record within linked list
-void editRecord(GameData*& head, const string& commandLine)
+//function to check whether two aggregate results are the same
+bool sameAggregate(const AggregateResult& a, const AggregateResult& b)
 {
-    //extract all fields from batch file command line:
-    //find positions of double quotes to extract game name
-    size_t doubleQuote1{ commandLine.find('\"') };
-    size_t doubleQuote2{ commandLine.find('\"', doubleQuote1 + 1) };
-
-    //extract name to edit from batchfile command line (between the two double quotes)
-    string batchfileName{ commandLine.substr(doubleQuote1 + 1, doubleQuote2 - (doubleQuote1 + 1)) };
-
-    //create variables for each space after second double quote(to use their positions as dilimiters for our fields)
-    size_t space1{ commandLine.find(' ', doubleQuote2) };
-    size_t space2{ commandLine.find(' ', space1 + 1) };
+    return a.count == b.count && a.value == b.value && a.overflowed == b.overflowed && a.records == b.records && a.low == b.low && a.width == b.width
+        && a.buckets == b.buckets;
+}
 
-    //extract field number and new value
-    string fieldNumber{ commandLine.substr(space1 + 1, 1) };  //string variable indicating which field to edit
-    string newValue{ commandLine.substr(space2 + 1) };        //string variable indicating new value for specified field
+//function to get the text printed for a value of a numeric field (revenue in dollars, with its $)
+FieldText aggregateValueText(SortKey field, long long value)
+{
+    FieldText text;
+    if (field == SortKey::Revenue)
+    {
+        text.digits[0] = '$';
+        text.size = 1 + formatCents(value, text.digits + 1);
+    }
+    else
+    {
+        text.size = formatInteger(value, text.digits);
+    }
+    return text;
+}
 
-    //create flag to track if name to edit can be found in linked list
-    bool foundNameToEdit{ false };
+//function to run an aggregate command and report its result
+void aggregateRecords(RecordList& list, ReportSink& report, const AggregateQuery& query)
+{
+    ++report.counts.aggregates;
+    if (report.quiet && !list.columns.check)
+    {
+        return;
+    }
 
-    //start iterating from head of list to find correct record to edit
-    GameData* currentNode = head;
+    AggregateResult result{ aggregateColumns(list, query) };
+    countVisited(list, list.columns.nodes.size());
+    if (list.columns.check && !sameAggregate(result, aggregateList(list, query)))
+    {
+        ++list.columns.mismatches;
+        cerr << "aggregate \"" << query.text << "\" does not match the scalar reference\n";
+    }
+    if (report.quiet)
+    {
+        return;
+    }
 
-    //loop through each node in list until end is reached (when current is nullptr)
-    while (currentNode != nullptr)
+    //print result, e.g. "SUM OF revenue: $1234.50", or the records/buckets under a heading
+    const char* field{ sortKeyName(query.field) };
+    switch (query.function)
     {
-        //if name from batchfile command matches current record's name
-        if (batchfileName == currentNode->name)
+    case AggregateFunction::Sum:
+        report << "SUM OF " << field << ": ";
+        if (result.overflowed)
         {
-            foundNameToEdit = true; //set flag to true as we have found the record to edit
-
-            //update correct field with new value depending on the field number:
-            if (fieldNumber == "1") //if field number is 1, update high score
-            {
-                //update high score to new value provided in command line
-                currentNode->highScore = newValue;
-
-                //output edited record's details to console
-                cout << currentNode->name << " UPDATED\n"
-                    << "UPDATE TO high score - VALUE " << cutLeadingZeroes(newValue) << '\n'
-                    << "Name: " << currentNode->name << '\n'
-                    << "High Score: " << cutLeadingZeroes(newValue) << '\n'
-                    << "Initials: " << currentNode->initials << '\n'
-                    << "Plays: " << currentNode->plays << '\n'
-                    << "Revenue: " << '$' << currentNode->revenue << '\n' << '\n';
-
-                //exit loop since record has been found and updated
-                break;
-            }
-            else if (fieldNumber == "2") //if field number is 2, update initials
-            {
-                //update player's initials to new value provided
-                currentNode->initials = newValue;
-
-                //output edited record's details to console
-                cout << currentNode->name << " UPDATED\n"
-                    << "UPDATE TO initials - VALUE " << newValue << '\n'
-                    << "Name: " << currentNode->name << '\n'
-                    << "High Score: " << currentNode->highScore << '\n'
-                    << "Initials: " << newValue << '\n'
-                    << "Plays: " << currentNode->plays << '\n'
-                    << "Revenue: " << '$' << currentNode->revenue << '\n' << '\n';
-
-                //exit loop since record has been found and updated
-                break;
-            }
-            else if (fieldNumber == "3") //if field number is 3, update plays(and thus revenue)
+            report << "OUT OF RANGE\n";
+        }
+        else
+        {
+            report << aggregateValueText(query.field, result.value) << '\n';
+        }
+        break;
+    case AggregateFunction::Min:
+    case AggregateFunction::Max:
+    case AggregateFunction::Percentile:
+        if (query.function == AggregateFunction::Percentile)
+        {
+            report << "PERCENTILE " << query.text.substr(query.text.rfind(' ') + 1) << " OF " << field << ": ";
+        }
+        else
+        {
+            report << (query.function == AggregateFunction::Min ? "MIN OF " : "MAX OF ") << field << ": ";
+        }
+        if (result.count == 0)
+        {
+            report << "NO RECORDS\n";
+        }
+        else
+        {
+            report << aggregateValueText(query.field, result.value) << '\n';
+        }
+        break;
+    case AggregateFunction::Top:
+        report << "TOP " << to_string(query.count) << " BY " << field << '\n';
+        for (GameData* node : result.records)
+        {
+            appendRecordLine(report.buffer, *node);
+            if (report.buffer.size() >= report.flushSize && !report.hold)
             {
-                //update number of plays to new value provided
-                currentNode->plays = newValue;
-
-                //since our plays changed, we need to recalculate revenue (multiply new value by 0.25)
-                //recalculate revenue by multiply plays by 0.25                                    
-                double newRevenue = stod(newValue) * 0.25;
-                stringstream revenueStream;                               //create stringstream for formatting
-                revenueStream << fixed << setprecision(2) << newRevenue;  //format to two decimal places
-                currentNode->revenue = revenueStream.str();               //convert back to string and update revenue in linked list
-
-                //output edited record's details to console
-                cout << currentNode->name << " UPDATED\n"
-                    << "UPDATE TO plays - VALUE " << cutLeadingZeroes(newValue) << '\n'
-                    << "Name: " << currentNode->name << '\n'
-                    << "High Score: " << currentNode->highScore << '\n'
-                    << "Initials: " << currentNode->initials << '\n'
-                    << "Plays: " << cutLeadingZeroes(newValue) << '\n'
-                    << "Revenue: " << '$' << currentNode->revenue << '\n' << '\n';
-
-                //exit loop since record has been found and updated
-                break;
+                flushReport(report);
             }
         }
-        //if current record is not one to be edited, move to next record in list
-        currentNode = currentNode->next;
-    }
-    //after entire list has been searched, verify if edit was performed
-    //if batchfile name to edit cannot be found in linked list, print message accordingly
-    if (foundNameToEdit == false)
-    {
-        cout << "Record to edit was not found.\n";
+        break;
+    case AggregateFunction::Histogram:
+        report << "HISTOGRAM OF " << field << " (" << to_string(query.count) << " BUCKETS)\n";
+        for (size_t bucket{ 0 }; bucket < result.buckets.size(); ++bucket)
+        {
+            long long first{ static_cast<long long>(static_cast<unsigned long long>(result.low) + bucket * result.width) };
+            long long last{ static_cast<long long>(static_cast<unsigned long long>(first) + result.width - 1) };
+            report << aggregateValueText(query.field, first) << " - " << aggregateValueText(query.field, last) << ": "
+                << to_string(result.buckets[bucket]) << '\n';
+        }
+        break;
     }
+    report << '\n';
 }
 
-//function to delete a record from linked list, given a game name
-void deleteRecord(GameData*& head, const string& recordToDelete)
+//function to read one bound of a range command into 'value': a whole number, or for revenue an amount of money
+//(with or without a $, and at most 2 decimals); * means no bound, and leaves 'value' as it is
+bool parseRangeBound(string_view word, SortKey field, long long& value)
 {
-    //initialize pointers to help traverse and modify list: 'prev' will point to node before current one
-    GameData* previousNode = nullptr;
-    //'current' starts from head of list and will be used to traverse list
-    GameData* currentNode = head;
-
-    //loop through each node in list until end is reached (when current is nullptr)
-    while (currentNode != nullptr)
+    if (word == "*")
+    {
+        return true;
+    }
+    if (field == SortKey::Revenue)
     {
-        //if current node's name matches name of record to delete (toLowercase for case-insensitivity)
-        if (toLowercase(currentNode->name) == toLowercase(recordToDelete))
+        if (!word.empty() && word[0] == '$')
         {
-            //store details for output before deletion
-            string name = currentNode->name;
-            string highScore = currentNode->highScore;
-            string initials = currentNode->initials;
-            string plays = currentNode->plays;
-            string revenue = currentNode->revenue;
-
-            //if 'prev' is nullptr, record to delete is at head of list
-            if (previousNode == nullptr)
-            {
-                //set 'head' to next node, which removes current head from list
-                head = currentNode->next;
-            }
-            //otherwise, if 'prev' is not nullptr, record to delete is not head of list
-            else
-            {
-                //move 'next' pointer of 'prev' node so it bypasses/skips over 'current' (by setting 'prev->next' to 'current->next')
-                //this links previous node directly to node after 'current' (effectively removes 'current' from list)
-                previousNode->next = currentNode->next;
-            }
-
-            //free memory allocated for current node (effectively deletes record)
-            delete currentNode;
-
-            //output deleted record's details to console
-            cout << "RECORD DELETED\n"
-                << "Name: " << name << '\n'
-                << "High Score: " << highScore << '\n'
-                << "Initials: " << initials << '\n'
-                << "Plays: " << plays << '\n'
-                << "Revenue: " << '$' << revenue << '\n' << '\n';
-
-            return; //exit function after record is deleted
+            word.remove_prefix(1);
         }
-
-        //if current node is not one to delete, continue to traverse list and get ready for next iteration
-        //move 'prev' and 'current' forward in list ('prev' becomes 'current', and 'current' becomes next node)
-        previousNode = currentNode;
-        currentNode = currentNode->next;
+        return !word.empty() && isdigit(static_cast<unsigned char>(word.back())) && exactCents(word, value);
     }
-    //if we exit while loop without returning, no matching record was found
-    cout << "Record to delete was not found in the database file.\n";
+    const char* end = word.data() + word.size();
+    auto result = from_chars(word.data(), end, value);
+    return !word.empty() && result.ec == errc() && result.ptr == end;
 }
 
-//function to sort linked list of game records in ascending order based on specified sort method
-void sortRecords(GameData*& head, const string& sortMethod)
+//function to turn the argument of a range command ("plays 100 200", "revenue $5 * desc", "highscore", ...) into a query
+//returns false if the field or a bound is not one we know, or the bounds are the wrong way round
+bool parseRangeQuery(string_view text, RangeQuery& query)
 {
-    int size = 0;                  //initialize counter variable to keep track of size of linked list (total number of nodes)
-    GameData* tempNode = head;     //create temporary pointer variable and initialize to point at head of list
+    //split into field word, optional bounds and optional "desc"
+    vector<string_view> words;
+    for (size_t start{ 0 }; ; )
+    {
+        size_t space{ text.find(' ', start) };
+        words.push_back(text.substr(start, space == string_view::npos ? string_view::npos : space - start));
+        if (space == string_view::npos)
+        {
+            break;
+        }
+        start = space + 1;
+    }
+    if (words.size() > 1 && words.back() == "desc")
+    {
+        query.descending = true;
+        words.pop_back();
+    }
+    if (words.size() != 1 && words.size() != 3)
+    {
+        return false;
+    }
 
-    //use temporary pointer to traverse linked list:
-    while (tempNode != nullptr) //while we have not reached past last node of list
+    //fields with an ordered index are the numeric ones
+    if (words[0] == "plays")
+    {
+        query.field = SortKey::Plays;
+    }
+    else if (words[0] == "highscore")
+    {
+        query.field = SortKey::HighScore;
+    }
+    else if (words[0] == "revenue")
+    {
+        query.field = SortKey::Revenue;
+    }
+    else
+    {
+        return false;
+    }
+    if (words.size() == 1)
     {
-        size++;             //increment size counter for each node
-        tempNode = tempNode->next;  //move temp to next node in list
+        return true;
     }
+    query.bounded = true;
+    return parseRangeBound(words[1], query.field, query.low) && parseRangeBound(words[2], query.field, query.high) && query.low <= query.high;
+}
 
-    //if list is empty or contains only one node, no sorting is needed
-    if (size < 2)
+//function to run a range command: list the records whose field is in the range, in order of the field, from the
+//field's ordered index (the list itself stays in the order it is in)
+void listRange(RecordList& list, ReportSink& report, const RangeQuery& query)
+{
+    buildOrderedIndex(list, query.field);
+    vector<OrderedEntry*> records;
+    collectOrdered(*orderedIndexFor(list, query.field), query.low, query.high, query.descending, records);
+    countVisited(list, records.size());
+    ++report.counts.ranges;
+    report.counts.rangeRecords += records.size();
+    if (report.quiet)
     {
         return;
     }
 
-    //use bubble sort algorithm to sort linked list:
-    bool flag = true; //initialize flag to true to enter sorting loop at least once
-
-    //continue looping as long as swap has occured in previous pass
-    while (flag)
+    //print the query, e.g. "RECORDS BY plays FROM 100 TO * DESCENDING", then the records
+    report << "RECORDS BY " << sortKeyName(query.field);
+    if (query.bounded)
     {
-        flag = false; //reset flag to false at start of each pass to see if swap occurs
-
-        //use pointer to a pointer to track current node and manage swaps involving head of list
-        GameData** currentPointer = &head;
-
-        //iterate over list, and reduce range by one after each full pass since last element is correctly sorted
-        for (int i = 0; i < size - 1 && (*currentPointer)->next != nullptr; ++i)
+        report << " FROM ";
+        if (query.low == numeric_limits<long long>::min())
         {
-            //dereference currentPointer to access the current node being examined
-            GameData* currentNode = *currentPointer;
-
-            //access the next node in the list for comparison and potential swapping
-            GameData* next = currentNode->next;
-
-            //determine if the current node and the next node need to be swapped based on sorting method:
-            //if sort method is by name, compare current name with name in next record; if sort method is plays, compare current plays with plays in next record
-            bool swapNeeded = (sortMethod == "name" && currentNode->name > next->name) ||
-                (sortMethod == "plays" && stoi(currentNode->plays) > stoi(next->plays));
+            report << '*';
+        }
+        else
+        {
+            report << aggregateValueText(query.field, query.low);
+        }
+        report << " TO ";
+        if (query.high == numeric_limits<long long>::max())
+        {
+            report << '*';
+        }
+        else
+        {
+            report << aggregateValueText(query.field, query.high);
+        }
+    }
+    report << (query.descending ? " DESCENDING\n" : "\n");
+    for (const OrderedEntry* entry : records)
+    {
+        appendRecordLine(report.buffer, *entry->node);
+        if (report.buffer.size() >= report.flushSize && !report.hold)
+        {
+            flushReport(report);
+        }
+    }
+    if (records.empty())
+    {
+        report << "NO RECORDS\n";
+    }
+    report << '\n';
+}
 
-            //if swap is needed based on above evaluation
-            if (swapNeeded)
-            {
-                //perform the swap by adjusting pointers; first, link current to the node after next
-                currentNode->next = next->next;
+//function to add one record to 'buffer' as a database line ("Name, HighScore, Initials, Plays, $Revenue")
+void appendRecordLine(string& buffer, const GameData& node)
+{
+    buffer.append(node.name.view());
+    buffer.append(", ");
+    buffer.append(highScoreText(node).view());
+    buffer.append(", ");
+    buffer.append(initialsText(node));
+    buffer.append(", ");
+    buffer.append(playsText(node).view());
+    buffer.append(", $");
+    buffer.append(revenueText(node).view());
+    buffer.push_back('\n');
+}
 
-                //then, link next back to current, effectively swapping their positions in list
-                next->next = currentNode;
+//function to print linked list data to file
+//records are formatted into one large buffer that is written out whenever it fills up, instead of one field at a time
+bool printList(ofstream& outputFile, const RecordList& list) 
+{
+    const size_t flushSize{ 1 << 20 };  //write buffer out once it holds this many characters
+    string buffer;
+    buffer.reserve(flushSize + 4096);
 
-                //update the pointer in the preceding node (or the head pointer) to point to next, completing the swap
-                *currentPointer = next;
+    //walk list from head to tail, printing each node's data to the buffer
+    for (GameData* node = firstRecord(list); node != nullptr; node = nextRecord(list, node))
+    {
+        appendRecordLine(buffer, *node);
+        if (buffer.size() >= flushSize)
+        {
+            outputFile.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    }
 
-                //set the flag to true, indicating that a swap occurred, and another pass is necessary
-                flag = true;
+    //write whatever is left in buffer
+    outputFile.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+    return static_cast<bool>(outputFile);
+}
 
-                //move the currentPointer forward to the next pair of nodes to continue sorting
-                currentPointer = &next->next;
-            }
-            //if no swap is needed, advance currentPointer to next node in preparation for next comparison
-            else
-            {
-                currentPointer = &currentNode->next;
-            }
+//function to add a record to a snapshot being put together
+void addSnapshotRecord(SnapshotBuilder& snapshot, const GameData& node)
+{
+    //add a piece of text to the heap (text that isn't stored at all stays that way)
+    auto addText = [&snapshot](TextRef text)
+    {
+        SnapshotString string{ snapshotNoText, 0, 0 };
+        if (text.data != nullptr)
+        {
+            string.offset = snapshot.heap.size();
+            string.size = text.size;
+            snapshot.heap.append(text.view());
         }
-        //decrement size after each pass through list because last element of unsorted section is now correctly placed
-        --size;
+        return string;
+    };
+
+    SnapshotRecord record{};
+    record.name = addText(node.name);
+    record.highScore = node.highScore;
+    record.plays = node.plays;
+    record.revenue = node.revenue;
+    memcpy(record.initials, node.initials, sizeof(record.initials));
+    record.text = snapshotNoText;
+    if (node.text != nullptr)
+    {
+        record.text = snapshot.texts.size();
+        snapshot.texts.push_back(SnapshotText{ addText(node.text->highScore), addText(node.text->plays),
+            addText(node.text->revenue), addText(node.text->initials) });
     }
+    snapshot.records.push_back(record);
+}
 
-    //after sorting, print sorted list to console:
+//function to write the records added to a snapshot out to a file (see SnapshotHeader), leaving the snapshot empty
+bool writeSnapshot(ofstream& outputFile, SnapshotBuilder& snapshot)
+{
+    //sections go into one buffer after the header, so the checksum can be worked out over them in one pass
+    string body;
+    body.reserve(snapshot.records.size() * sizeof(SnapshotRecord) + snapshot.texts.size() * sizeof(SnapshotText) + snapshot.heap.size());
+    body.append(reinterpret_cast<const char*>(snapshot.records.data()), snapshot.records.size() * sizeof(SnapshotRecord));
+    body.append(reinterpret_cast<const char*>(snapshot.texts.data()), snapshot.texts.size() * sizeof(SnapshotText));
+    body.append(snapshot.heap);
 
-    //if sort method is name, print out 'name' to console, otherwise print out 'plays'
-    cout << "RECORDS SORTED BY " << (sortMethod == "name" ? "name" : "plays") << '\n';
+    SnapshotHeader header{};
+    memcpy(header.magic, "ARCADEDB", 8);
+    header.version = snapshotVersion;
+    header.byteOrder = 0x01020304;
+    header.recordSize = sizeof(SnapshotRecord);
+    header.textSize = sizeof(SnapshotText);
+    header.recordCount = snapshot.records.size();
+    header.textCount = snapshot.texts.size();
+    header.heapSize = snapshot.heap.size();
+    header.checksum = snapshotChecksum(body.data(), body.size());
 
-    //traverse through entire linked list of currents
-    for (GameData* node = head; node != nullptr; node = node->next)
+    outputFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    outputFile.write(body.data(), static_cast<streamsize>(body.size()));
+    snapshot.records.clear();
+    snapshot.texts.clear();
+    snapshot.heap.clear();
+    return static_cast<bool>(outputFile);
+}
+
+//function to write linked list to a file as a snapshot (see SnapshotHeader)
+bool printSnapshot(ofstream& outputFile, const RecordList& list)
+{
+    SnapshotBuilder snapshot;
+    for (GameData* node = firstRecord(list); node != nullptr; node = nextRecord(list, node))
     {
-        //print out game record data for each node
-        cout << node->name << ", " << node->highScore << ", " << node->initials
-            << ", " << node->plays << ", $" << node->revenue << '\n';
+        addSnapshotRecord(snapshot, *node);
     }
-    cout << '\n';
+    return writeSnapshot(outputFile, snapshot);
 }
 
-//recursive function to print linked list data to file
-void printList(ofstream& outputFile, GameData* head) 
+//function to make sure a file's contents have reached the disk (not just the operating system's cache)
+bool syncFile(const string& filename)
 {
-    //base case: check if current node (head) is null, indicating end of list  
-    if (head == nullptr) 
+#ifndef _WIN32
+    int descriptor = open(filename.c_str(), O_RDONLY);
+    if (descriptor < 0)
     {
-        return; //there is nothing more to print, so return from function
+        return false;
     }
-    
-    //if current node (head) is not nullptr, we print its data to file:
-    outputFile << head->name << ", " 
-               << head->highScore << ", "
-               << head->initials << ", "
-               << head->plays << ", $"  
-               << head->revenue << '\n';
-    //recursive call: move to next node in list and try to print its data
-    //will continue until base case is met (when head becomes nullptr, meaning we're at end of list)
-    printList(outputFile, head->next);
+    bool synced = fsync(descriptor) == 0;
+    close(descriptor);
+    return synced;
+#else
+    (void)filename;
+    return true;
+#endif
 }
 
-//function to write linked list to file
-void writeRecordsToFile(GameData* head, const string& filename) 
+//function to write linked list to file, as text (like the database file) or as a snapshot
+//with 'atomic' set, records are written to a temporary file that then replaces 'filename' in one step,
+//so a crash part way through never leaves a half-written file behind
+bool writeRecordsToFile(const RecordList& list, const string& filename, bool atomic, DatabaseFormat format) 
 {
-    //create output filestream object, 'filename' parameter used to open or create file where list's data will be stored
-    ofstream newDatfile(filename); 
+    //file actually written to: the real file, or a temporary file next to it
+    string target{ atomic ? filename + ".tmp" : filename };
+
+    //create output filestream object, 'target' used to open or create file where list's data will be stored
+    //(snapshots are binary, so no line ending translation may happen to them)
+    ofstream newDatfile(target, format == DatabaseFormat::Snapshot ? ios::out | ios::binary : ios::out); 
 
     //check if data file can be opened; if it cannot, print an error to the console and exit
     if (!newDatfile)
     {
         cerr << "Error: datafile could not be opened for writing.\n";
-        return;
+        return false;
     }
 
-    //call recursive print function, which will write data of each node of linked list to 'newDatfile'
-    printList(newDatfile, head); 
+    //call print function, which will write data of each node of linked list to 'newDatfile'
+    bool written = format == DatabaseFormat::Snapshot ? printSnapshot(newDatfile, list) : printList(newDatfile, list); 
 
     //close filestream object 
     newDatfile.close();            
+    if (!written || !newDatfile)
+    {
+        cerr << "Error: datafile could not be written.\n";
+        return false;
+    }
+
+    //move finished temporary file over the real one (only once its contents are safely on disk)
+    if (atomic)
+    {
+        if (!syncFile(target) || rename(target.c_str(), filename.c_str()) != 0)
+        {
+            cerr << "Error: datafile could not be replaced.\n";
+            remove(target.c_str());
+            return false;
+        }
+    }
+    return true;
 }